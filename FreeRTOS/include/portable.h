@@ -135,9 +135,55 @@ typedef struct HeapRegion
  * defines a region of memory that can be used as the heap.  The array is
  * terminated by a HeapRegions_t structure that has a size of 0.  The region
  * with the lowest start address must appear first in the array.
+ *
+ * heap_777.c also provides it when configHEAP_USE_REGIONS is 1, and takes up to
+ * configHEAP_MAXIMUM_REGION_NUM regions, which vPortPoolInitRegions() then
+ * refers to by their index in the array.
  */
 void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions ) PRIVILEGED_FUNCTION;
 
+/*
+ * Memory attributes that pvPortMallocCaps() can ask for.  A request is only
+ * served from memory that has every flag asked for.
+ */
+#define portMALLOC_CAP_DMA				( ( uint32_t ) 0x01UL )	/* Reachable by the DMA engines. */
+#define portMALLOC_CAP_NONCACHEABLE		( ( uint32_t ) 0x02UL )	/* Not cached, so DMA needs no cache maintenance. */
+#define portMALLOC_CAP_FAST				( ( uint32_t ) 0x04UL )	/* Tightly coupled or otherwise zero wait state. */
+#define portMALLOC_CAP_EXTERNAL			( ( uint32_t ) 0x08UL )	/* Off chip, such as PSRAM. */
+
+/*
+ * As vPortDefineHeapRegions(), provided by heap_777.c when
+ * configHEAP_USE_REGIONS is 1.  pulCapsList, which may be NULL, gives the
+ * portMALLOC_CAP_ flags of each region in pxHeapRegions.
+ */
+void vPortDefineHeapRegionsCaps( const HeapRegion_t * const pxHeapRegions, const uint32_t *pulCapsList ) PRIVILEGED_FUNCTION;
+
+/* Used by heap_777.c to report the state of the heap as a whole, and of each
+of its pools. */
+typedef struct xHeapStats
+{
+	size_t xAvailableHeapSpaceInBytes;		/* The same value as xPortGetFreeHeapSize(). */
+	size_t xMinimumEverFreeBytesRemaining;	/* The same value as xPortGetMinimumEverFreeHeapSize(). */
+	size_t xUnallocatedBytes;				/* The bytes not carved into a pool block or large block, or given back since. */
+	size_t xSpanReserveBytes;				/* The bytes of pool spans given back by xPortReclaimPoolSpans(), which any pool can carve again. */
+	size_t xLargeBlocksInUse;				/* The number of large blocks currently allocated. */
+	size_t xNumberOfFreeLargeBlocks;		/* The number of blocks on the large block free list. */
+	size_t xFreeLargeBlockBytes;			/* The bytes held by those blocks. */
+	size_t xSizeOfLargestFreeLargeBlock;	/* The largest of those blocks, including its header. */
+	size_t xNumberOfPools;					/* The number of pools, which may be more than were reported. */
+} HeapStats_t;
+
+typedef struct xHeapPoolStats
+{
+	size_t xBlockSize;			/* The usable size of the pool's blocks. */
+	size_t xBlocksInUse;		/* Blocks allocated, or held in a task cache. */
+	size_t xFreeBlocks;			/* Blocks on the pool's free list. */
+	size_t xMaxBlocksInUse;		/* The highest xBlocksInUse has ever been. */
+	size_t xAllocations;		/* The number of allocations the pool has served. */
+	size_t xRoundingWaste;		/* Bytes lost rounding those requests up to xBlockSize. */
+	size_t xOverheadBytes;		/* Bytes lost to headers and padding in the carved blocks. */
+} HeapPoolStats_t;
+
 
 /*
  * Map to the memory management routines required for the port.
@@ -148,6 +194,443 @@ void vPortInitialiseBlocks( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetMinimumEverFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * Allocate memory that has every portMALLOC_CAP_ flag in ulCaps, or return
+ * NULL.  The block is freed with vPortFree().  If ulCaps is 0 this is the same
+ * as pvPortMalloc().  heap_4.c, and heap_777.c without regions, have a single
+ * heap whose flags are given by configHEAP_CAPS.  heap_777.c with regions
+ * picks a region that has the flags, and still uses the pool that fits the
+ * request where it can.
+ */
+void *pvPortMallocCaps( size_t xWantedSize, uint32_t ulCaps ) PRIVILEGED_FUNCTION;
+
+/*
+ * Allocate memory whose address is a multiple of xAlignment, which must be a
+ * power of two, and which is freed with vPortFree().  heap_4.c and heap_777.c
+ * give the space skipped to reach the alignment back to the free list, so
+ * nothing is lost to it.  In heap_777.c aligned blocks always come from the
+ * large block list.
+ */
+void *pvPortMallocAligned( size_t xWantedSize, size_t xAlignment ) PRIVILEGED_FUNCTION;
+
+/*
+ * Change the size of the block pv points to, keeping its contents up to the
+ * smaller of the two sizes.  pv may be NULL, and a size of 0 frees the block.
+ * The block is resized in place where possible, so the returned pointer is
+ * often pv itself; if the block has to move and there is no room for it NULL
+ * is returned and pv is left untouched.  heap_4.c grows a block into the free
+ * block above it, and heap_777.c keeps a block in place while the new size
+ * still fits its pool.
+ */
+void *pvPortRealloc( void *pv, size_t xWantedSize ) PRIVILEGED_FUNCTION;
+
+/*
+ * Used by heap_777.c to lay out its fixed size pools.  pxSizeList holds
+ * xListLength block sizes in any order.  Sizes are rounded up to
+ * portBYTE_ALIGNMENT and duplicates dropped.  Must be called before the first
+ * call to pvPortMalloc(), otherwise the default sizes are already in use and
+ * pdFALSE is returned.
+ *
+ * pxReserveList, which may be NULL, gives for each entry of pxSizeList the
+ * number of blocks to carve onto that pool's free list up front.  pdFALSE is
+ * returned, and nothing is carved, if the reservations do not fit the heap.
+ *
+ * If configHEAP_POOL_CLASSES fixes the pool sizes at compile time, pxSizeList
+ * must hold exactly those sizes, and pdFALSE is returned otherwise.
+ */
+BaseType_t vPortPoolInit( const size_t *pxSizeList, const size_t *pxReserveList, size_t xListLength ) PRIVILEGED_FUNCTION;
+
+/*
+ * As vPortPoolInit(), but pxRegionList, which may be NULL, also gives for each
+ * entry of pxSizeList the index of the heap region that pool's blocks are
+ * carved from.  Once that region is full blocks are carved from the others, in
+ * order.  Large blocks prefer region configHEAP_LARGE_BLOCK_REGION.  pdFALSE is
+ * returned if an index is not that of a region passed to
+ * vPortDefineHeapRegions(), which must be called first.
+ */
+BaseType_t vPortPoolInitRegions( const size_t *pxSizeList, const size_t *pxReserveList, const size_t *pxRegionList, size_t xListLength ) PRIVILEGED_FUNCTION;
+
+/*
+ * Allocate or free xCount blocks in one go.  pvPortMallocBatch() writes
+ * xCount pointers, each to a block of at least xSize bytes, to ppvBlocks and
+ * returns ppvBlocks[ 0 ].  It is all or nothing - if every block can not be
+ * allocated none are, and NULL is returned.  vPortFreeBatch() accepts any mix
+ * of blocks, and skips NULL entries.  In heap_777.c the scheduler is suspended
+ * once per call and runs of blocks from the same pool are moved as one chain.
+ */
+void *pvPortMallocBatch( size_t xSize, size_t xCount, void *ppvBlocks[] ) PRIVILEGED_FUNCTION;
+void vPortFreeBatch( void *ppvBlocks[], size_t xCount ) PRIVILEGED_FUNCTION;
+
+/*
+ * Interrupt safe versions of pvPortMalloc() and vPortFree(), provided by
+ * heap_777.c when configHEAP_USE_ISR_API is 1.  pvPortMallocFromISR() only
+ * returns blocks already on the free list of the pool that fits xSize - it
+ * never carves new memory - and returns NULL otherwise.  vPortFreeFromISR()
+ * only accepts blocks that came from a pool.  With
+ * configHEAP_USE_LOCK_FREE_POOLS set neither masks interrupts.
+ */
+void *pvPortMallocFromISR( size_t xSize ) PRIVILEGED_FUNCTION;
+void vPortFreeFromISR( void *pv ) PRIVILEGED_FUNCTION;
+
+/*
+ * Give the calling task a private cache of free pool blocks, provided by
+ * heap_777.c when configHEAP_USE_TASK_CACHE is 1.  The cache is kept in the
+ * task's thread local storage pointer configHEAP_TASK_CACHE_TLS_INDEX, and holds
+ * at most configHEAP_TASK_CACHE_MAX_BYTES.  Before pvPortMalloc() fails it gives
+ * the calling task's cached blocks back and tries again.  A task must call
+ * vPortTaskCacheDelete() before it is deleted, otherwise the blocks in its cache
+ * are lost.
+ */
+BaseType_t xPortTaskCacheCreate( void ) PRIVILEGED_FUNCTION;
+void vPortTaskCacheDelete( void ) PRIVILEGED_FUNCTION;
+
+/*
+ * Pools of fixed size objects, provided by heap_777.c when
+ * configHEAP_USE_OBJECT_POOLS is 1.  xPortObjectPoolCreate() takes room for
+ * xCapacity objects of xObjectSize bytes from the heap in one allocation, and
+ * returns NULL if it can not.  pvPortObjectPoolAlloc() returns a free object
+ * of the pool, or NULL once all xCapacity are in use - the pool never grows.
+ * An object must go back with vPortObjectPoolFree() to the pool it came from,
+ * never with vPortFree().  The pool's objects are freed together by
+ * vPortObjectPoolDelete(), which must not be called while any is in use.
+ *
+ * Taking and giving an object suspends the scheduler, or with
+ * configHEAP_USE_POOL_LOCKS takes the pool lock, so a pool can be shared
+ * between tasks.  Set configHEAP_PRIVATE_OBJECT_POOLS to 1 if every pool is
+ * only ever used by one task, and neither is then more than the list pop or
+ * push.  Object pools must not be used from an interrupt.
+ */
+typedef struct ObjectPool * ObjectPoolHandle_t;
+
+ObjectPoolHandle_t xPortObjectPoolCreate( size_t xObjectSize, size_t xCapacity ) PRIVILEGED_FUNCTION;
+void vPortObjectPoolDelete( ObjectPoolHandle_t xObjectPool ) PRIVILEGED_FUNCTION;
+void *pvPortObjectPoolAlloc( ObjectPoolHandle_t xObjectPool ) PRIVILEGED_FUNCTION;
+void vPortObjectPoolFree( ObjectPoolHandle_t xObjectPool, void *pv ) PRIVILEGED_FUNCTION;
+size_t xPortObjectPoolGetFreeCount( ObjectPoolHandle_t xObjectPool ) PRIVILEGED_FUNCTION;
+
+/*
+ * Take a snapshot of the heap in one call, provided by heap_777.c.  The state
+ * of the first xPoolStatsLength pools, smallest first, is written to
+ * pxPoolStats, which may be NULL.  The scheduler is suspended while the free
+ * large blocks are counted.
+ */
+void vPortGetHeapStats( HeapStats_t *pxHeapStats, HeapPoolStats_t *pxPoolStats, size_t xPoolStatsLength ) PRIVILEGED_FUNCTION;
+
+/*
+ * Write a binary snapshot of every free block in the heap to pucBuffer,
+ * provided by heap_777.c.  The heap is locked only while the free lists are
+ * copied, so the snapshot can be sent out afterwards by DMA or a low priority
+ * task without holding up the rest of the system.  Returns the number of bytes
+ * written, or 0 if xBufferLength can not hold the header and pool table.  If
+ * the buffer fills up the snapshot is cut short and marked as truncated.  See
+ * heap_777_snapshot.py for the format and a decoder.
+ */
+size_t xPortGetHeapSnapshot( uint8_t *pucBuffer, size_t xBufferLength ) PRIVILEGED_FUNCTION;
+
+/*
+ * Give every pool span whose blocks are all free back to the span reserve, so
+ * any pool can carve it again, provided by heap_777.c when configHEAP_USE_SPANS
+ * is 1.  Intended to be called from the idle hook.  Each pool's free list is
+ * sorted by address, O( n log n ) in its free blocks, while the scheduler is
+ * suspended, or with configHEAP_USE_POOL_LOCKS set while the pool's list is
+ * detached from it.  Returns the number of spans given back.
+ */
+size_t xPortReclaimPoolSpans( void ) PRIVILEGED_FUNCTION;
+
+/*
+ * Merge adjacent free blocks, provided by heap_2.c when
+ * configHEAP_USE_DEFERRED_COALESCING is 1.  Intended to be called from the
+ * idle hook.  Returns the number of blocks merged away, which is 0 if nothing
+ * has been freed since the last call.  pvPortMalloc() only runs the pass
+ * itself, before failing a request, if configHEAP_COALESCE_ON_FAILURE is also
+ * 1, and that allocation then takes as long as the whole pass.
+ */
+size_t xPortCoalesceFreeBlocks( void ) PRIVILEGED_FUNCTION;
+
+/*
+ * Per task and per tag accounting of live heap blocks, provided by
+ * heap_tags.c when configHEAP_USE_ALLOCATION_TAGS is 1.  Every heap
+ * implementation reports its allocations and frees through the
+ * portHEAP_TAG_ hooks below, and heap_tags.c keeps the owner, tag and size of
+ * each live block in a side table of configHEAP_TAG_TABLE_SIZE records.
+ *
+ * pvPortMallocTagged() is pvPortMalloc() followed by vPortHeapTagSet(), which
+ * tags a block that is already allocated.  xPortGetTaskHeapUsage() sums the
+ * bytes held by blocks xTask allocated - pass NULL for blocks allocated before
+ * the scheduler started or from an interrupt.  xPortGetTagHeapUsage() sums the
+ * bytes held by blocks with tag ulTag, 0 being untagged.
+ * xPortGetHeapTagMisses() returns the number of allocations that were not
+ * recorded because the table was full.
+ */
+#ifndef configHEAP_USE_ALLOCATION_TAGS
+	#define configHEAP_USE_ALLOCATION_TAGS	0
+#endif
+
+struct tskTaskControlBlock;
+void *pvPortMallocTagged( size_t xWantedSize, uint32_t ulTag ) PRIVILEGED_FUNCTION;
+void vPortHeapTagSet( void *pv, uint32_t ulTag ) PRIVILEGED_FUNCTION;
+size_t xPortGetTaskHeapUsage( struct tskTaskControlBlock *xTask ) PRIVILEGED_FUNCTION;
+size_t xPortGetTagHeapUsage( uint32_t ulTag ) PRIVILEGED_FUNCTION;
+size_t xPortGetHeapTagMisses( void ) PRIVILEGED_FUNCTION;
+
+/*
+ * The hooks the heap implementations call.  xSize is the number of bytes the
+ * block takes from the heap.  They compile away when
+ * configHEAP_USE_ALLOCATION_TAGS is 0.
+ */
+void vPortHeapTagRecord( void *pv, size_t xSize ) PRIVILEGED_FUNCTION;
+void vPortHeapTagRecordFromISR( void *pv, size_t xSize ) PRIVILEGED_FUNCTION;
+void vPortHeapTagResize( void *pv, size_t xSize ) PRIVILEGED_FUNCTION;
+void vPortHeapTagForget( void *pv ) PRIVILEGED_FUNCTION;
+void vPortHeapTagForgetFromISR( void *pv ) PRIVILEGED_FUNCTION;
+
+#if( configHEAP_USE_ALLOCATION_TAGS == 1 )
+	#define portHEAP_TAG_RECORD( pv, xSize )			vPortHeapTagRecord( ( pv ), ( xSize ) )
+	#define portHEAP_TAG_RECORD_FROM_ISR( pv, xSize )	vPortHeapTagRecordFromISR( ( pv ), ( xSize ) )
+	#define portHEAP_TAG_RESIZE( pv, xSize )			vPortHeapTagResize( ( pv ), ( xSize ) )
+	#define portHEAP_TAG_FORGET( pv )					vPortHeapTagForget( pv )
+	#define portHEAP_TAG_FORGET_FROM_ISR( pv )			vPortHeapTagForgetFromISR( pv )
+#else
+	#define portHEAP_TAG_RECORD( pv, xSize )
+	#define portHEAP_TAG_RECORD_FROM_ISR( pv, xSize )
+	#define portHEAP_TAG_RESIZE( pv, xSize )
+	#define portHEAP_TAG_FORGET( pv )
+	#define portHEAP_TAG_FORGET_FROM_ISR( pv )
+#endif
+
+/*
+ * Allocation tracing, provided by heap_trace.c when configHEAP_USE_TRACE is 1.
+ * Every heap implementation reports each allocation, free and in place resize
+ * through the portHEAP_TRACE_ hooks below, and heap_trace.c writes them into
+ * xHeapTrace, a ring of configHEAP_TRACE_BUFFER_SIZE records that always holds
+ * the latest operations.  The whole structure can be read out by a debugger or
+ * copied by DMA and turned into a trace for the host benchmark with
+ * heap_trace_decode.py, or drained from a task with xPortHeapTraceRead().
+ *
+ * vPortHeapTraceEnable() stops and restarts recording, for example to keep
+ * the operations leading up to a failure.  Recording starts enabled.
+ *
+ * xPortHeapTraceRead() copies out up to xMaxRecords records, starting from
+ * record number *pulNextRecord, and moves *pulNextRecord on past them.  If the
+ * reader has fallen more than configHEAP_TRACE_BUFFER_SIZE records behind, it
+ * skips to the oldest record still held, so the jump in *pulNextRecord is the
+ * number of records lost.  Start a reader with *pulNextRecord set to 0.
+ */
+#ifndef configHEAP_USE_TRACE
+	#define configHEAP_USE_TRACE	0
+#endif
+
+/* The operation of a HeapTraceRecord_t, in the top two bits of ulOpAndSize.
+The rest holds the size requested.  A failed allocation is recorded with a
+NULL pvBlock. */
+#define portHEAP_TRACE_OP_MALLOC		( ( uint32_t ) 0x00000000UL )
+#define portHEAP_TRACE_OP_FREE			( ( uint32_t ) 0x40000000UL )
+#define portHEAP_TRACE_OP_REALLOC		( ( uint32_t ) 0x80000000UL )	/* Resized in place, so pvBlock did not move. */
+#define portHEAP_TRACE_OP_MASK			( ( uint32_t ) 0xC0000000UL )
+
+typedef struct xHeapTraceRecord
+{
+	uint32_t ulTimestamp;				/* configHEAP_TRACE_TIMESTAMP() when the operation was recorded. */
+	uint32_t ulOpAndSize;				/* portHEAP_TRACE_OP_ | size requested. */
+	void *pvBlock;						/* The pointer returned or freed. */
+	struct tskTaskControlBlock *xTask;	/* The task, or NULL from an interrupt. */
+} HeapTraceRecord_t;
+
+void vPortHeapTraceEnable( BaseType_t xEnable ) PRIVILEGED_FUNCTION;
+size_t xPortHeapTraceRead( HeapTraceRecord_t *pxRecords, size_t xMaxRecords, uint32_t *pulNextRecord ) PRIVILEGED_FUNCTION;
+
+/*
+ * The hooks the heap implementations call.  They compile away when
+ * configHEAP_USE_TRACE is 0.  A free is recorded before the block goes back to
+ * the heap, and an allocation once it has been taken, so the trace never shows
+ * a block handed out twice.
+ */
+void vPortHeapTraceRecord( uint32_t ulOp, void *pv, size_t xSize ) PRIVILEGED_FUNCTION;
+void vPortHeapTraceRecordFromISR( uint32_t ulOp, void *pv, size_t xSize ) PRIVILEGED_FUNCTION;
+
+#if( configHEAP_USE_TRACE == 1 )
+	#define portHEAP_TRACE_MALLOC( pv, xSize )				vPortHeapTraceRecord( portHEAP_TRACE_OP_MALLOC, ( pv ), ( xSize ) )
+	#define portHEAP_TRACE_MALLOC_FROM_ISR( pv, xSize )		vPortHeapTraceRecordFromISR( portHEAP_TRACE_OP_MALLOC, ( pv ), ( xSize ) )
+	#define portHEAP_TRACE_REALLOC( pv, xSize )				vPortHeapTraceRecord( portHEAP_TRACE_OP_REALLOC, ( pv ), ( xSize ) )
+	#define portHEAP_TRACE_FREE( pv )						vPortHeapTraceRecord( portHEAP_TRACE_OP_FREE, ( pv ), 0 )
+	#define portHEAP_TRACE_FREE_FROM_ISR( pv )				vPortHeapTraceRecordFromISR( portHEAP_TRACE_OP_FREE, ( pv ), 0 )
+#else
+	#define portHEAP_TRACE_MALLOC( pv, xSize )
+	#define portHEAP_TRACE_MALLOC_FROM_ISR( pv, xSize )
+	#define portHEAP_TRACE_REALLOC( pv, xSize )
+	#define portHEAP_TRACE_FREE( pv )
+	#define portHEAP_TRACE_FREE_FROM_ISR( pv )
+#endif
+
+/*
+ * Heap corruption guards, provided by heap_guard.c when configHEAP_USE_GUARDS
+ * is 1, for hunting down code that writes past a block or uses one after
+ * freeing it.  Every heap implementation then makes each block
+ * portHEAP_GUARD_OVERHEAD bytes bigger than asked for.  The bytes from the end
+ * of the request to the end of the block are a red zone, filled with canary
+ * bytes apart from its last word, which holds the size that was asked for.
+ * Freeing a block checks its header and its red zone, then poisons the whole
+ * block so stale data read through a dangling pointer stands out.  A block
+ * that fails the checks - overrun, freed twice, or never allocated - is passed
+ * to configHEAP_GUARD_FAILED() and left alone rather than freed.  All of this
+ * compiles away when configHEAP_USE_GUARDS is 0.
+ */
+#ifndef configHEAP_USE_GUARDS
+	#define configHEAP_USE_GUARDS	0
+#endif
+
+/* The fewest canary bytes after each request. */
+#ifndef configHEAP_GUARD_BYTES
+	#define configHEAP_GUARD_BYTES	8
+#endif
+
+/* Called with the block that failed a check. */
+#ifndef configHEAP_GUARD_FAILED
+	#define configHEAP_GUARD_FAILED( pv )	configASSERT( ( pv ) == NULL )
+#endif
+
+/*
+ * The hooks the heap implementations call.  xUsableSize is the number of bytes
+ * from pv to the end of the block.  vPortHeapGuardArm() does nothing if pv is
+ * NULL.  xPortHeapGuardCheck() returns pdFALSE if the red zone has been
+ * written to.
+ */
+void vPortHeapGuardArm( void *pv, size_t xRequestedSize, size_t xUsableSize ) PRIVILEGED_FUNCTION;
+BaseType_t xPortHeapGuardCheck( const void *pv, size_t xUsableSize ) PRIVILEGED_FUNCTION;
+void vPortHeapGuardPoison( void *pv, size_t xUsableSize ) PRIVILEGED_FUNCTION;
+
+#if( configHEAP_USE_GUARDS == 1 )
+	#define portHEAP_GUARD_OVERHEAD							( ( size_t ) configHEAP_GUARD_BYTES + sizeof( size_t ) )
+	#define portHEAP_GUARDED_SIZE( xSize )					( ( ( xSize ) == 0 ) ? ( size_t ) 0 : ( ( ( xSize ) > ( ( size_t ) -1 ) - portHEAP_GUARD_OVERHEAD ) ? ( size_t ) -1 : ( xSize ) + portHEAP_GUARD_OVERHEAD ) )
+	#define portHEAP_GUARD_ARM( pv, xRequestedSize, xUsableSize )	vPortHeapGuardArm( ( pv ), ( xRequestedSize ), ( xUsableSize ) )
+	#define portHEAP_GUARD_POISON( pv, xUsableSize )			vPortHeapGuardPoison( ( pv ), ( xUsableSize ) )
+#else
+	#define portHEAP_GUARD_OVERHEAD							( ( size_t ) 0 )
+	#define portHEAP_GUARDED_SIZE( xSize )					( xSize )
+	#define portHEAP_GUARD_ARM( pv, xRequestedSize, xUsableSize )
+	#define portHEAP_GUARD_POISON( pv, xUsableSize )
+#endif
+
+/*
+ * Timing of the sections the heap implementations run with the scheduler
+ * suspended, provided by heap_timing.c when configHEAP_USE_TIMING is 1.  Each
+ * section is timed in cycles of configHEAP_CYCLE_COUNT(), and its count,
+ * shortest, longest and a histogram of run times are kept.  The insert
+ * section runs within the others, so its cycles are also counted by them.
+ * The figures leave out the few cycles spent recording them.
+ *
+ * vPortGetHeapTimingStats() copies the figures of the first xStatsLength
+ * sections, up to portHEAP_TIMING_SECTIONS, into pxStats.
+ * vPortResetHeapTimingStats() clears them, so a worst case can be measured
+ * over one test.
+ */
+#ifndef configHEAP_USE_TIMING
+	#define configHEAP_USE_TIMING	0
+#endif
+
+/* A free running 32-bit cycle counter, read by heap_trace.c and heap_timing.c.
+The default is DWT_CYCCNT, present on ARMv7-M and ARMv8-M mainline cores, which
+the application must start by setting TRCENA in CoreDebug->DEMCR and CYCCNTENA
+in DWT->CTRL.  Define it to read some other counter on other cores. */
+#ifndef configHEAP_CYCLE_COUNT
+	#define configHEAP_CYCLE_COUNT()	( *( ( volatile uint32_t * ) 0xE0001004UL ) )
+#endif
+
+/* The number of histogram buckets.  Bucket n counts sections that took from
+2^n to 2^(n+1)-1 cycles, except that bucket 0 also counts those that took 0,
+and the last bucket counts everything longer. */
+#ifndef configHEAP_TIMING_BUCKETS
+	#define configHEAP_TIMING_BUCKETS	16
+#endif
+
+#define portHEAP_TIMING_MALLOC		( ( UBaseType_t ) 0 )	/* The suspended sections of pvPortMalloc(). */
+#define portHEAP_TIMING_FREE		( ( UBaseType_t ) 1 )	/* The suspended sections of vPortFree(). */
+#define portHEAP_TIMING_INSERT		( ( UBaseType_t ) 2 )	/* Returning a block to the free list. */
+#define portHEAP_TIMING_SECTIONS	( ( UBaseType_t ) 3 )
+
+typedef struct xHeapTimingStats
+{
+	uint32_t ulCount;									/* The number of times the section ran. */
+	uint32_t ulMinimumCycles;							/* The shortest it took, 0 if it never ran. */
+	uint32_t ulMaximumCycles;							/* The longest it took. */
+	uint32_t ulHistogram[ configHEAP_TIMING_BUCKETS ];	/* How often it took each power of two range of cycles. */
+} HeapTimingStats_t;
+
+void vPortGetHeapTimingStats( HeapTimingStats_t *pxStats, size_t xStatsLength ) PRIVILEGED_FUNCTION;
+void vPortResetHeapTimingStats( void ) PRIVILEGED_FUNCTION;
+
+/*
+ * The hooks the heap implementations call at the start and end of each
+ * section, with the scheduler suspended.  They compile away when
+ * configHEAP_USE_TIMING is 0.
+ */
+void vPortHeapTimingStart( UBaseType_t uxSection ) PRIVILEGED_FUNCTION;
+void vPortHeapTimingStop( UBaseType_t uxSection ) PRIVILEGED_FUNCTION;
+
+#if( configHEAP_USE_TIMING == 1 )
+	#define portHEAP_TIMING_START( uxSection )	vPortHeapTimingStart( uxSection )
+	#define portHEAP_TIMING_STOP( uxSection )	vPortHeapTimingStop( uxSection )
+#else
+	#define portHEAP_TIMING_START( uxSection )
+	#define portHEAP_TIMING_STOP( uxSection )
+#endif
+
+/*
+ * Low memory callbacks, provided by heap_reclaim.c when configHEAP_USE_RECLAIM
+ * is 1, so the application can give memory back - flush a cache, shrink a
+ * buffer - while the heap is getting full rather than after it has run out.
+ *
+ * xPortHeapAddReclaimCallback() registers pxCallback, to be called with
+ * pvParameter the first time pvPortMalloc() leaves fewer than xWatermark bytes
+ * of the heap free.  It is not called for that watermark again until an
+ * allocation finds at least xWatermark bytes free.  heap_777.c also provides
+ * xPortPoolAddReclaimCallback(), whose watermark is a number of blocks the
+ * pool that pvPortMalloc( xBlockSize ) is served from can still hand out -
+ * its free blocks, and those it could still carve from the unallocated heap
+ * or, with configHEAP_USE_SPANS, the span reserve.  Register those after
+ * vPortPoolInit().  At most configHEAP_RECLAIM_CALLBACKS callbacks can be
+ * registered, and both functions return pdFALSE once the table is full.
+ *
+ * When pvPortMalloc() finds no room it calls every callback of the heap, and
+ * of the pool the request maps to, whatever their watermarks, then tries once
+ * more before calling vApplicationMallocFailedHook().
+ *
+ * Callbacks run in the task that called pvPortMalloc(), with the scheduler
+ * running, so they can free memory or even allocate it.  Only one task runs
+ * callbacks at a time.  Allocations made while they run, by the callbacks or
+ * by any other task, run none themselves and are not retried.  Nothing is
+ * called from pvPortMallocFromISR(), or for blocks served by a task cache.
+ */
+#ifndef configHEAP_USE_RECLAIM
+	#define configHEAP_USE_RECLAIM	0
+#endif
+
+#ifndef configHEAP_RECLAIM_CALLBACKS
+	#define configHEAP_RECLAIM_CALLBACKS	4
+#endif
+
+typedef void ( *HeapReclaimCallback_t )( void *pvParameter );
+
+BaseType_t xPortHeapAddReclaimCallback( size_t xWatermark, HeapReclaimCallback_t pxCallback, void *pvParameter ) PRIVILEGED_FUNCTION;
+BaseType_t xPortPoolAddReclaimCallback( size_t xBlockSize, size_t xWatermark, HeapReclaimCallback_t pxCallback, void *pvParameter ) PRIVILEGED_FUNCTION;
+
+/*
+ * The hooks the heap implementations call when configHEAP_USE_RECLAIM is 1,
+ * with the scheduler running.  xSource is portHEAP_RECLAIM_HEAP for the whole
+ * heap, where xFree is in bytes, or the index of a pool, where it is in free
+ * blocks.  vPortHeapReclaimCheck() calls the callbacks of xSource whose
+ * watermark xFree is below.  xPortHeapReclaimBegin() calls every callback of
+ * the heap and of xSource and returns pdTRUE if there were any, in which case
+ * the heap retries the allocation and then calls vPortHeapReclaimEnd().  While
+ * callbacks are running both return without calling any.
+ */
+#define portHEAP_RECLAIM_HEAP	( ( size_t ) -1 )
+
+BaseType_t xPortHeapReclaimAdd( size_t xSource, size_t xWatermark, HeapReclaimCallback_t pxCallback, void *pvParameter ) PRIVILEGED_FUNCTION;
+void vPortHeapReclaimCheck( size_t xSource, size_t xFree ) PRIVILEGED_FUNCTION;
+BaseType_t xPortHeapReclaimBegin( size_t xSource ) PRIVILEGED_FUNCTION;
+void vPortHeapReclaimEnd( void ) PRIVILEGED_FUNCTION;
+
 /*
  * Setup the hardware ready for the scheduler to take control.  This generally
  * sets up a tick interrupt and sets timers for the correct tick frequency.
@@ -180,4 +663,3 @@ void vPortEndScheduler( void ) PRIVILEGED_FUNCTION;
 #endif /* PORTABLE_H */
 
 void vPrintFreeList(void) PRIVILEGED_FUNCTION;
-BaseType_t vPortPoolInit(size_t *) PRIVILEGED_FUNCTION;
@@ -52,237 +52,3987 @@ task.h is included from an application file. */
 	#error This file must not be used if configSUPPORT_DYNAMIC_ALLOCATION is 0
 #endif
 
-/* A few bytes might be lost to byte aligning the heap start address. */
-#define configADJUSTED_HEAP_SIZE	( configTOTAL_HEAP_SIZE - portBYTE_ALIGNMENT )
+/* When configHEAP_USE_REGIONS is 1 there is no ucHeap array.  The heap is
+ * instead made of up to configHEAP_MAXIMUM_REGION_NUM regions passed to
+ * vPortDefineHeapRegions(), which must be called before the first allocation,
+ * and each pool can say which region its blocks are carved from first.
+ */
+#ifndef configHEAP_USE_REGIONS
+	#define configHEAP_USE_REGIONS	0
+#endif
+
+#if( configHEAP_USE_REGIONS == 1 )
+
+	#ifndef configHEAP_MAXIMUM_REGION_NUM
+		#define configHEAP_MAXIMUM_REGION_NUM	4
+	#endif
+
+	/* The region fresh large blocks are carved from first. */
+	#ifndef configHEAP_LARGE_BLOCK_REGION
+		#define configHEAP_LARGE_BLOCK_REGION	0
+	#endif
+
+	#define heapMAXIMUM_REGION_NUM	configHEAP_MAXIMUM_REGION_NUM
+
+	#if( heapMAXIMUM_REGION_NUM > 32 )
+		#error configHEAP_MAXIMUM_REGION_NUM must fit in the uint32_t region masks
+	#endif
+
+#else
+
+	/* A few bytes might be lost to byte aligning the heap start address. */
+	#define configADJUSTED_HEAP_SIZE	( configTOTAL_HEAP_SIZE - portBYTE_ALIGNMENT )
+
+	/* Allocate the memory for the heap. */
+	#if( configAPPLICATION_ALLOCATED_HEAP == 1 )
+		/* The application writer has already defined the array used for the RTOS
+		heap - probably so it can be placed in a special segment or address. */
+		extern uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+	#else
+		static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+	#endif /* configAPPLICATION_ALLOCATED_HEAP */
+
+	#define heapMAXIMUM_REGION_NUM	1
+	#define configHEAP_LARGE_BLOCK_REGION	0
+
+	/* The portMALLOC_CAP_ flags that describe the memory ucHeap is placed
+	in. */
+	#ifndef configHEAP_CAPS
+		#define configHEAP_CAPS	0
+	#endif
+
+#endif /* configHEAP_USE_REGIONS */
+
+/* Define the linked list structure. Block_t is used to link free blocks with
+ * same size, and Pool_t is used to record the head of each list.
+ */
+typedef struct Pool Pool_t;
+typedef struct Block Block_t;
+typedef struct LargeBlock LargeBlock_t;
+typedef struct Region Region_t;
+
+/* When configHEAP_USE_LOCK_FREE_POOLS is 1 the pool free lists are lock free
+ * Treiber stacks.  Each push and pop is a compare and swap on the list head,
+ * which holds the index of the first block and a tag that changes every time
+ * the head does, so a pop can not succeed against a head that was popped and
+ * pushed back in between.  The counters the pools share are updated with
+ * atomic adds.  Nothing on the pool path then suspends the scheduler or masks
+ * interrupts unless a fresh block has to be carved, which still takes a short
+ * critical section, as it does with configHEAP_USE_POOL_LOCKS.
+ *
+ * configHEAP_ATOMIC_CAS( pxWord, xExpected, xDesired ) must atomically set the
+ * size_t at pxWord to xDesired if it holds xExpected, and evaluate to non-zero
+ * if it did.  configHEAP_ATOMIC_ADD( pxWord, xDelta ) must atomically add
+ * xDelta to it and evaluate to the new value.  Both default to the GCC
+ * builtins, which are LDREX/STREX loops on ARMv7-M.  A port whose pools are
+ * shared with another core must make sure the memory they are in supports
+ * exclusive accesses from both.
+ */
+#ifndef configHEAP_USE_LOCK_FREE_POOLS
+	#define configHEAP_USE_LOCK_FREE_POOLS	0
+#endif
+
+#if( configHEAP_USE_LOCK_FREE_POOLS == 1 )
+
+	#ifndef configHEAP_ATOMIC_CAS
+		#define configHEAP_ATOMIC_CAS( pxWord, xExpected, xDesired )	__sync_bool_compare_and_swap( ( pxWord ), ( xExpected ), ( xDesired ) )
+	#endif
+
+	#ifndef configHEAP_ATOMIC_ADD
+		#define configHEAP_ATOMIC_ADD( pxWord, xDelta )	__sync_add_and_fetch( ( pxWord ), ( xDelta ) )
+	#endif
+
+	#if( configHEAP_USE_REGIONS == 1 )
+		#error configHEAP_USE_LOCK_FREE_POOLS indexes blocks from the start of a single contiguous heap, so can not be used with configHEAP_USE_REGIONS
+	#endif
+
+#endif /* configHEAP_USE_LOCK_FREE_POOLS */
+
+/* When configHEAP_USE_SPANS is 1 pool blocks carry no header at all.  The pool
+ * part of the heap is carved in spans of whole pages, each span holding blocks
+ * of a single pool, and the pool of a block is found from its address through
+ * a page map.  Large blocks are then carved from the top of the heap down, so
+ * the two kinds can also be told apart by address.
+ *
+ * A span whose blocks have all been freed can be given back to a reserve that
+ * every pool carves from before the unallocated heap, so memory a burst of one
+ * size left behind can later be used by another.  Nothing is counted as blocks
+ * come and go.  Instead xPortReclaimPoolSpans(), meant for the idle hook,
+ * sorts each pool's free list by address and picks out the complete spans.
+ * A pool that runs out of room also does this, once, before it gives up.
+ */
+#ifndef configHEAP_USE_SPANS
+	#define configHEAP_USE_SPANS	0
+#endif
+
+#if( configHEAP_USE_SPANS == 1 ) && ( configHEAP_USE_REGIONS == 1 )
+	#error configHEAP_USE_SPANS needs the single contiguous heap, so can not be used with configHEAP_USE_REGIONS
+#endif
+
+struct Pool
+{
+#if( configHEAP_USE_LOCK_FREE_POOLS == 1 )
+    volatile size_t xFirstFree; /* The first free block in this pool, as a tagged head. */
+#else
+    Block_t *pxFirstFree;   /* The first free block in this pool. */
+#endif
+    size_t xBlockSize;      /* The size of the free block in this pool. */
+    size_t xRegion;         /* The region fresh blocks are carved from first. */
+#if( configHEAP_USE_SPANS == 1 )
+    size_t xSpanSize;       /* The number of bytes carved for this pool at a time. */
+#endif
+    size_t xBlocksCarved;   /* The number of blocks carved for this pool and not given back. */
+    size_t xBlocksInUse;    /* The number of blocks not on the free list. */
+    size_t xMaxBlocksInUse; /* The highest value xBlocksInUse has reached. */
+    size_t xAllocations;    /* The number of blocks handed out so far. */
+    size_t xRoundingWaste;  /* The bytes lost to rounding up over all of those. */
+};
+
+struct Block
+{
+#if( configHEAP_USE_SPANS == 0 )
+    Pool_t *pxPool;         /* The pool this block belongs to. */
+#endif
+    Block_t *pxNext;        /* The next free block in the list, only valid while the block is free. */
+};
+
+/* A large block shares the header size of Block_t.  Its first word holds the
+ * block size with heapLARGE_BLOCK_BIT set instead of a pool pointer, which is
+ * always aligned, so vPortFree() can tell the two kinds apart.  With spans the
+ * pool blocks have no header and this is the only header in the heap.
+ */
+struct LargeBlock
+{
+    size_t xBlockSize;                  /* The size of the block, including its header. */
+    LargeBlock_t *pxNextFreeBlock;      /* The next free large block, in address order. */
+};
+
+#define heapLARGE_BLOCK_BIT		( ( size_t ) 1 )
+
+/* A contiguous piece of memory that blocks are carved from, bottom up.  Without
+ * configHEAP_USE_REGIONS there is exactly one, over ucHeap.
+ */
+struct Region
+{
+    uint8_t *pucHeapStart;  /* The aligned start of the region. */
+    Block_t *pxFreeHeap;    /* The first byte not yet carved. */
+    uint8_t *pucHeapEnd;    /* The first byte past the region, see below. */
+    size_t xRegionSize;     /* The bytes in the region, after alignment. */
+#if( configHEAP_USE_REGIONS == 1 )
+    uint32_t ulCaps;        /* The portMALLOC_CAP_ flags the region's memory has. */
+#endif
+};
+
+/* The k-th region to try when xPreferred is wanted - xPreferred first, then
+the rest in order. */
+#define heapREGION_ORDER( xPreferred, k )	( ( ( k ) == 0 ) ? ( xPreferred ) : ( ( ( k ) <= ( xPreferred ) ) ? ( ( k ) - 1 ) : ( k ) ) )
+
+/* Regions are picked through a mask with one bit per region. */
+#define heapALL_REGIONS			( ~( ( uint32_t ) 0 ) )
+#define heapREGION_BIT( x )		( ( ( uint32_t ) 1 ) << ( x ) )
+
+#if( configHEAP_USE_REGIONS == 1 )
+	#define heapIN_REGIONS( pv, ulRegionMask )	( ( ( ulRegionMask ) == heapALL_REGIONS ) || ( ( prvRegionMaskOf( pv ) & ( ulRegionMask ) ) != 0 ) )
+#else
+	#define heapIN_REGIONS( pv, ulRegionMask )	( pdTRUE )
+#endif
+
+/*
+ * Initialises the heap structures before their first use.
+ */
+static void prvHeapInit( void );
+
+/*
+ * Initialises the heap, and the pools with the default sizes, if that has not
+ * been done yet.
+ */
+static void prvEnsureInitialised( void );
+
+/*
+ * Sets up the pools and the class lookup table from a sorted, aligned size
+ * list.  pxRegionList, which may be NULL, gives the preferred region of each
+ * pool.  Must be called with the scheduler suspended.
+ */
+static void prvPoolInit( const size_t *pxSizeList, const size_t *pxRegionList, size_t xListLength );
+
+/*
+ * Carves xBlockCount blocks of xStride bytes from the unallocated heap onto the
+ * free list of pxPoolToFill, lowest address first, taking them from the pool's
+ * preferred region while it has room.  The caller must have checked that the
+ * space is available.
+ */
+static void prvReservePoolBlocks( Pool_t *pxPoolToFill, size_t xBlockCount, size_t xStride );
+
+#if( configHEAP_USE_SPANS == 0 )
+
+	/*
+	 * Carves xSize bytes from the unallocated part of a region in ulRegionMask,
+	 * trying xRegion[ xPreferred ] first and then the others in order.  Returns
+	 * NULL if no such region has room.  Spans carve the single region
+	 * directly.
+	 */
+	static void *prvCarve( size_t xPreferred, uint32_t ulRegionMask, size_t xSize );
+
+#endif
+
+#if( configHEAP_USE_REGIONS == 1 )
+
+	/*
+	 * Returns the heapREGION_BIT() of the region holding pv, or 0.
+	 */
+	static uint32_t prvRegionMaskOf( const void *pv );
+
+#endif
+
+/*
+ * Pushes a chain of xChainLength blocks, linked through pxNext from pxHead to
+ * pxTail and all from the same pool, onto that pool's free list.
+ */
+static void prvPushChainToPool( Block_t *pxHead, Block_t *pxTail, size_t xChainLength );
+
+/*
+ * Pops up to xCount blocks from xPool[ xPoolIndex ] under a single lock,
+ * writing the application pointers to ppvBlocks.  Returns the number popped.
+ * The blocks are counted as in use, but the watermarks are not moved.
+ */
+static size_t prvPopBlocks( size_t xPoolIndex, void *ppvBlocks[], size_t xCount );
+
+/*
+ * Gives the xCount blocks at ppvBlocks, taken for a batch of xPool[ xPoolIndex ]
+ * that could not be completed, back to the pool.  Nothing was traced, tagged
+ * or armed for them, so none of that is undone.
+ */
+static void prvGiveBackBatch( size_t xPoolIndex, void *ppvBlocks[], size_t xCount );
+
+/*
+ * Stores ulValue at pucBuffer[ xOffset ], which need not be aligned, and
+ * returns the offset of the next word.
+ */
+static size_t prvSnapshotPut( uint8_t *pucBuffer, size_t xOffset, uint32_t ulValue );
+
+#if( configHEAP_USE_GUARDS == 1 )
+
+	/*
+	 * Returns the bytes the application can use in the block at pv, red zone
+	 * included.
+	 */
+	static size_t prvGuardUsableSize( void *pv );
+
+	/*
+	 * Marks the block at pv, which may be NULL, as in use and arms its red zone
+	 * for a request of xRequestedSize bytes.
+	 */
+	static void prvGuardArm( void *pv, size_t xRequestedSize );
+
+	/*
+	 * Returns pdTRUE if pv is a block in use with an intact red zone.  Otherwise
+	 * calls configHEAP_GUARD_FAILED() and returns pdFALSE.
+	 */
+	static BaseType_t prvGuardCheck( void *pv );
+
+	/*
+	 * Checks the block at pv as prvGuardCheck() does and, if it passes, marks it
+	 * free and poisons it.
+	 */
+	static BaseType_t prvGuardRelease( void *pv );
+
+#endif
+
+#if( configHEAP_USE_RECLAIM == 1 )
+
+	/*
+	 * Returns the number of blocks xPool[ xPoolIndex ] can still hand out: its
+	 * free blocks, and as many more as it could carve from the unallocated
+	 * heap and, with spans, the span reserve.  This is what pool reclaim
+	 * watermarks are measured against.
+	 */
+	static size_t prvPoolBlocksAvailable( size_t xPoolIndex );
+
+#endif
+
+#if( configHEAP_USE_SPANS == 1 )
+
+	/*
+	 * Returns the span size that wastes the least memory for blocks of
+	 * xStride bytes, stopping at the first that wastes at most an eighth.
+	 */
+	static size_t prvSpanSizeFor( size_t xStride );
+
+	/*
+	 * Carves one span for xPool[ xPoolIndex ], from the span reserve if it has
+	 * room or else from the unallocated heap, and pushes all of its blocks
+	 * onto the pool's free list.  Returns pdFALSE if neither has room for
+	 * another span, even after prvReclaimSpans().
+	 */
+	static BaseType_t prvCarveSpan( size_t xPoolIndex );
+
+	/*
+	 * Take xPages pages from the span reserve, or return NULL if no run of
+	 * free pages is that long.  prvReserveSpan() puts the xPages pages at
+	 * pucSpan back, merging them with the runs either side.  Both are called
+	 * with the bump lock held.
+	 */
+	static uint8_t *prvTakeReservedSpan( size_t xPages );
+	static void prvReserveSpan( uint8_t *pucSpan, size_t xPages );
+
+	/*
+	 * Gives every span whose blocks are all on its pool's free list back to
+	 * the span reserve, and returns the number of spans given back.  The
+	 * caller must have done heapMALLOC_SUSPEND().
+	 */
+	static size_t prvReclaimSpans( void );
+	static size_t prvReclaimPoolSpans( size_t xPoolIndex );
+
+	/*
+	 * Sorts the NULL terminated block list pxList by address and returns its
+	 * new head.
+	 */
+	static Block_t *prvSortBlocks( Block_t *pxList );
+
+#endif
+
+/*
+ * Requests larger than the biggest pool are served from an address ordered
+ * list of variable sized blocks, which is carved from the unallocated heap
+ * and coalesced on free in the same way as heap_4.c.
+ */
+static void *prvAllocateLargeBlock( size_t xWantedSize, uint32_t ulRegionMask );
+static void prvFreeLargeBlock( LargeBlock_t *pxBlock );
+static void prvInsertBlockIntoFreeList( LargeBlock_t *pxBlockToInsert );
+
+/*
+ * As prvInsertBlockIntoFreeList(), but the block stays on the list even if it
+ * borders the unallocated heap.  Returns the block it ended up part of once
+ * merged with its neighbours.
+ */
+static LargeBlock_t *prvLinkBlockIntoFreeList( LargeBlock_t *pxBlockToInsert );
+
+/*
+ * If the free large block pxBlock, which is on the free list, borders the
+ * unallocated heap then takes it off the list and gives it back, so the bump
+ * headroom is not lost to blocks freed at the edge of the carved area.
+ */
+static void prvReleaseTrailingBlock( LargeBlock_t *pxBlock );
+
+/*
+ * As prvAllocateLargeBlock(), but the address returned is a multiple of
+ * xAlignment.  The space in front of the block goes back to the free list.
+ */
+static void *prvAllocateAlignedLargeBlock( size_t xWantedSize, size_t xAlignment );
+
+/*
+ * Carves a large block of xWantedSize bytes from the unallocated heap, or
+ * returns NULL.  The block's size is set but it is on no list.
+ */
+static LargeBlock_t *prvCarveLargeBlock( size_t xWantedSize, uint32_t ulRegionMask );
+
+/*
+ * Accounts for pxBlock, which is on no list, being handed to the application
+ * and returns the pointer to give it.
+ */
+static void *prvClaimLargeBlock( LargeBlock_t *pxBlock );
+
+/*
+ * Makes the allocated large block pxBlock xWantedSize bytes long without
+ * moving it, by giving its tail back to the free list or by taking in the free
+ * block that follows it.  Returns pdFALSE, leaving the block as it was, if the
+ * block can not grow that far where it is.
+ */
+static BaseType_t prvResizeLargeBlock( LargeBlock_t *pxBlock, size_t xWantedSize );
+
+#ifndef configHEAP_USE_TASK_CACHE
+	#define configHEAP_USE_TASK_CACHE	0
+#endif
+
+#if( configHEAP_USE_TASK_CACHE == 1 )
+
+	/*
+	 * Serve a pool sized request from, or return a pool block to, the calling
+	 * task's cache.  Return NULL / pdFALSE if the task has no cache or the
+	 * request can not be met from it, in which case the shared pools are used.
+	 */
+	static void *prvTaskCacheAllocate( size_t xWantedSize );
+	static BaseType_t prvTaskCacheFree( Block_t *pxLink );
+
+	/*
+	 * Give every block in the calling task's cache back to the shared pools,
+	 * leaving the cache empty but in place.  Returns pdTRUE if any block was
+	 * given back.
+	 */
+	static BaseType_t prvTaskCacheFlush( void );
+
+#endif
+
+static const uint16_t heapSTRUCT_SIZE	= ( ( sizeof ( LargeBlock_t ) + ( portBYTE_ALIGNMENT - 1 ) ) & ~portBYTE_ALIGNMENT_MASK );
+#define heapMINIMUM_BLOCK_SIZE	( ( size_t ) ( heapSTRUCT_SIZE * 2 ) )
+
+#if( configHEAP_USE_SPANS == 1 )
+
+	/* The unit the page map works in.  Must be a power of two, and a span is
+	at most heapSPAN_MAX_PAGES pages long. */
+	#ifndef configHEAP_SPAN_PAGE_SIZE
+		#define configHEAP_SPAN_PAGE_SIZE	512
+	#endif
+
+	#define heapSPAN_MAX_PAGES		8
+	#define heapSPAN_PAGE_COUNT		( configADJUSTED_HEAP_SIZE / configHEAP_SPAN_PAGE_SIZE )
+
+	#if( ( configHEAP_SPAN_PAGE_SIZE & ( configHEAP_SPAN_PAGE_SIZE - 1 ) ) != 0 ) || ( configHEAP_SPAN_PAGE_SIZE < portBYTE_ALIGNMENT )
+		#error configHEAP_SPAN_PAGE_SIZE must be a power of two no smaller than portBYTE_ALIGNMENT
+	#endif
+
+	/* Pool blocks have no header. */
+	#define heapPOOL_HEADER_SIZE			( ( size_t ) 0 )
+
+	/* The page of the heap that holds the byte at pv, and the pool that owns
+	the span the page belongs to. */
+	#define heapPAGE_OF( pv )				( ( size_t ) ( ( ( uint8_t * ) ( pv ) - xRegion[ 0 ].pucHeapStart ) / configHEAP_SPAN_PAGE_SIZE ) )
+	#define heapPOOL_OF( pxBlock )			( &( xPool[ ucSpanMap[ heapPAGE_OF( pxBlock ) ] ] ) )
+	#define heapSET_POOL( pxBlock, pxOwner )
+
+	/* Large blocks live above the unallocated heap, pool spans below it. */
+	#define heapIS_LARGE_BLOCK( pv )		( ( uint8_t * ) ( pv ) >= xRegion[ 0 ].pucHeapEnd )
+
+#else
+
+	#define heapPOOL_HEADER_SIZE			( ( size_t ) heapSTRUCT_SIZE )
+
+	#if( configHEAP_USE_GUARDS == 1 )
+
+		/* Pool_t is at least 4 byte aligned, so the second bit of a pool
+		pointer is free to mark a block that is in use. */
+		#define heapPOOL_ALLOCATED_BIT		( ( portPOINTER_SIZE_TYPE ) 2 )
+		#define heapPOOL_OF( pxBlock )		( ( Pool_t * ) ( void * ) ( ( portPOINTER_SIZE_TYPE ) ( pxBlock )->pxPool & ~heapPOOL_ALLOCATED_BIT ) )
+
+		typedef char heapPOOL_HAS_ALLOCATED_BIT_t[ ( sizeof( size_t ) >= 4 ) ? 1 : -1 ];
+
+	#else
+		#define heapPOOL_OF( pxBlock )		( ( pxBlock )->pxPool )
+	#endif
+
+	#define heapSET_POOL( pxBlock, pxOwner )	( pxBlock )->pxPool = ( pxOwner )
+	#define heapIS_LARGE_BLOCK( pv )		( ( ( ( LargeBlock_t * ) ( ( uint8_t * ) ( pv ) - heapSTRUCT_SIZE ) )->xBlockSize & heapLARGE_BLOCK_BIT ) != 0 )
+
+#endif /* configHEAP_USE_SPANS */
+
+/* Convert between a pool block and the pointer handed to the application. */
+#define heapBLOCK_TO_USER( pxBlock )	( ( void * ) ( ( uint8_t * ) ( pxBlock ) + heapPOOL_HEADER_SIZE ) )
+#define heapUSER_TO_BLOCK( pv )			( ( Block_t * ) ( void * ) ( ( uint8_t * ) ( pv ) - heapPOOL_HEADER_SIZE ) )
+
+/* The distance between consecutive blocks of a pool. */
+#define heapPOOL_STRIDE( xBlockSize )	( ( ( xBlockSize ) + heapPOOL_HEADER_SIZE + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK ) )
+
+/* With configHEAP_USE_GUARDS set every request is grown by the red zone before
+ * it is matched to a pool, and a block is checked before it is freed or
+ * resized.  Pool blocks with a header are marked in use by heapPOOL_ALLOCATED_BIT
+ * and large blocks by heapLARGE_BLOCK_BIT.  Span pool blocks have no header, so
+ * are checked against the page map instead, and a second free of one is caught
+ * by its poisoned red zone.  Object pool objects are not guarded.
+ */
+#if( configHEAP_USE_GUARDS == 1 )
+	#define heapGUARD_GROW( xSize )				( xSize ) = portHEAP_GUARDED_SIZE( xSize )
+	#define heapGUARD_ARM( pv, xRequestedSize )	prvGuardArm( ( pv ), ( xRequestedSize ) )
+	#define heapGUARD_CHECK( pv )				prvGuardCheck( pv )
+	#define heapGUARD_RELEASE( pv )				prvGuardRelease( pv )
+#else
+	#define heapGUARD_GROW( xSize )
+	#define heapGUARD_ARM( pv, xRequestedSize )
+	#define heapGUARD_CHECK( pv )				( pdTRUE )
+	#define heapGUARD_RELEASE( pv )				( pdTRUE )
+#endif
+
+/* When configHEAP_POOL_CLASSES is defined it lists, as plain integer constants
+ * separated by commas, the block sizes of the pools in ascending order, for
+ * example:
+ *
+ * #define configHEAP_POOL_CLASSES	32, 64, 128, 256, 512
+ *
+ * The pools are then fixed at compile time.  The list is checked by the
+ * preprocessor, and the pool for a request is found by comparing its size
+ * against each class as a constant, so the lookup is a few compare and add
+ * instructions with no table in RAM.  vPortPoolInit() can then only be given
+ * the same sizes, to reserve blocks or choose regions for them.
+ */
+#ifdef configHEAP_POOL_CLASSES
+
+	/* The most classes the list can hold. */
+	#define heapCLASS_LIMIT		16
+
+	/* Expand the list, padded with zeros, into the arguments of xMacro. */
+	#define heapCLASS_APPLY( xMacro, xArguments )	xMacro xArguments
+	#define heapCLASS_ARGUMENTS		( configHEAP_POOL_CLASSES, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 )
+
+	#define heapCLASS_SELECT_0( a, ... )	a
+	#define heapCLASS_SELECT_1( a, b, ... )	b
+	#define heapCLASS_SELECT_2( a, b, c, ... )	c
+	#define heapCLASS_SELECT_3( a, b, c, d, ... )	d
+	#define heapCLASS_SELECT_4( a, b, c, d, e, ... )	e
+	#define heapCLASS_SELECT_5( a, b, c, d, e, f, ... )	f
+	#define heapCLASS_SELECT_6( a, b, c, d, e, f, g, ... )	g
+	#define heapCLASS_SELECT_7( a, b, c, d, e, f, g, h, ... )	h
+	#define heapCLASS_SELECT_8( a, b, c, d, e, f, g, h, i, ... )	i
+	#define heapCLASS_SELECT_9( a, b, c, d, e, f, g, h, i, j, ... )	j
+	#define heapCLASS_SELECT_10( a, b, c, d, e, f, g, h, i, j, k, ... )	k
+	#define heapCLASS_SELECT_11( a, b, c, d, e, f, g, h, i, j, k, l, ... )	l
+	#define heapCLASS_SELECT_12( a, b, c, d, e, f, g, h, i, j, k, l, m, ... )	m
+	#define heapCLASS_SELECT_13( a, b, c, d, e, f, g, h, i, j, k, l, m, n, ... )	n
+	#define heapCLASS_SELECT_14( a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, ... )	o
+	#define heapCLASS_SELECT_15( a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, ... )	p
+	#define heapCLASS_SELECT_16( a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, q, ... )	q
+
+	/* The size of class n, or 0 past the end of the list. */
+	#define heapCLASS( n )	heapCLASS_APPLY( heapCLASS_SELECT_##n, heapCLASS_ARGUMENTS )
+
+	/* The number of classes is the position of the first zero. */
+	#define heapCLASS_COUNT														\
+		( ( heapCLASS( 0 ) != 0 ) + ( heapCLASS( 1 ) != 0 ) + ( heapCLASS( 2 ) != 0 ) +		\
+		  ( heapCLASS( 3 ) != 0 ) + ( heapCLASS( 4 ) != 0 ) + ( heapCLASS( 5 ) != 0 ) +		\
+		  ( heapCLASS( 6 ) != 0 ) + ( heapCLASS( 7 ) != 0 ) + ( heapCLASS( 8 ) != 0 ) +		\
+		  ( heapCLASS( 9 ) != 0 ) + ( heapCLASS( 10 ) != 0 ) + ( heapCLASS( 11 ) != 0 ) +	\
+		  ( heapCLASS( 12 ) != 0 ) + ( heapCLASS( 13 ) != 0 ) + ( heapCLASS( 14 ) != 0 ) +	\
+		  ( heapCLASS( 15 ) != 0 ) )
+
+	/* Class n is in order if it is larger than the one before it, or if it and
+	all the classes after it are padding. */
+	#define heapCLASS_IN_ORDER( n, m )	( ( heapCLASS( n ) > heapCLASS( m ) ) || ( heapCLASS_COUNT <= n ) )
+
+	#if( heapCLASS( 16 ) != 0 )
+		#error configHEAP_POOL_CLASSES can not list more than heapCLASS_LIMIT classes
+	#endif
+
+	#if( heapCLASS( 0 ) == 0 )
+		#error configHEAP_POOL_CLASSES must list at least one class
+	#endif
+
+	#if( !( heapCLASS_IN_ORDER( 1, 0 ) && heapCLASS_IN_ORDER( 2, 1 ) && heapCLASS_IN_ORDER( 3, 2 ) &&			\
+			heapCLASS_IN_ORDER( 4, 3 ) && heapCLASS_IN_ORDER( 5, 4 ) && heapCLASS_IN_ORDER( 6, 5 ) &&			\
+			heapCLASS_IN_ORDER( 7, 6 ) && heapCLASS_IN_ORDER( 8, 7 ) && heapCLASS_IN_ORDER( 9, 8 ) &&			\
+			heapCLASS_IN_ORDER( 10, 9 ) && heapCLASS_IN_ORDER( 11, 10 ) && heapCLASS_IN_ORDER( 12, 11 ) &&		\
+			heapCLASS_IN_ORDER( 13, 12 ) && heapCLASS_IN_ORDER( 14, 13 ) && heapCLASS_IN_ORDER( 15, 14 ) ) )
+		#error configHEAP_POOL_CLASSES must be in strictly ascending order, and must not contain a 0
+	#endif
+
+	#if( ( ( heapCLASS( 0 ) | heapCLASS( 1 ) | heapCLASS( 2 ) | heapCLASS( 3 ) | heapCLASS( 4 ) | heapCLASS( 5 ) |		\
+			 heapCLASS( 6 ) | heapCLASS( 7 ) | heapCLASS( 8 ) | heapCLASS( 9 ) | heapCLASS( 10 ) | heapCLASS( 11 ) |		\
+			 heapCLASS( 12 ) | heapCLASS( 13 ) | heapCLASS( 14 ) | heapCLASS( 15 ) ) & portBYTE_ALIGNMENT_MASK ) != 0 )
+		#error Every size in configHEAP_POOL_CLASSES must be a multiple of portBYTE_ALIGNMENT
+	#endif
+
+	/* The classes are in order, so the largest is the last one given. */
+	#define heapCLASS_LARGEST																				\
+		( ( heapCLASS( 15 ) != 0 ) ? heapCLASS( 15 ) : ( heapCLASS( 14 ) != 0 ) ? heapCLASS( 14 ) :		\
+		  ( heapCLASS( 13 ) != 0 ) ? heapCLASS( 13 ) : ( heapCLASS( 12 ) != 0 ) ? heapCLASS( 12 ) :		\
+		  ( heapCLASS( 11 ) != 0 ) ? heapCLASS( 11 ) : ( heapCLASS( 10 ) != 0 ) ? heapCLASS( 10 ) :		\
+		  ( heapCLASS( 9 ) != 0 ) ? heapCLASS( 9 ) : ( heapCLASS( 8 ) != 0 ) ? heapCLASS( 8 ) :			\
+		  ( heapCLASS( 7 ) != 0 ) ? heapCLASS( 7 ) : ( heapCLASS( 6 ) != 0 ) ? heapCLASS( 6 ) :			\
+		  ( heapCLASS( 5 ) != 0 ) ? heapCLASS( 5 ) : ( heapCLASS( 4 ) != 0 ) ? heapCLASS( 4 ) :			\
+		  ( heapCLASS( 3 ) != 0 ) ? heapCLASS( 3 ) : ( heapCLASS( 2 ) != 0 ) ? heapCLASS( 2 ) :			\
+		  ( heapCLASS( 1 ) != 0 ) ? heapCLASS( 1 ) : heapCLASS( 0 ) )
+
+	#ifndef configHEAP_MAXIMUM_POOL_BLOCK_SIZE
+		#define configHEAP_MAXIMUM_POOL_BLOCK_SIZE	heapCLASS_LARGEST
+	#endif
+
+	#if( configHEAP_MAXIMUM_POOL_BLOCK_SIZE < heapCLASS_LARGEST )
+		#error configHEAP_MAXIMUM_POOL_BLOCK_SIZE must not be smaller than the largest of configHEAP_POOL_CLASSES
+	#endif
+
+	/* There is exactly one pool per class. */
+	#define heapMAXIMUM_POOL_NUM	heapCLASS_COUNT
+
+	/* The pool for a request is the number of classes too small for it, which
+	is heapMAXIMUM_POOL_NUM if no class can hold it.  Classes past the end of the
+	list drop out as the compiler folds the constants. */
+	#define heapCLASS_TOO_SMALL( n, xSize )	( ( size_t ) ( ( heapCLASS_COUNT > n ) && ( ( xSize ) > ( size_t ) heapCLASS( n ) ) ) )
+	#define heapPOOL_CLASS_OF( xSize )																\
+		( heapCLASS_TOO_SMALL( 0, xSize ) + heapCLASS_TOO_SMALL( 1, xSize ) + heapCLASS_TOO_SMALL( 2, xSize ) +		\
+		  heapCLASS_TOO_SMALL( 3, xSize ) + heapCLASS_TOO_SMALL( 4, xSize ) + heapCLASS_TOO_SMALL( 5, xSize ) +		\
+		  heapCLASS_TOO_SMALL( 6, xSize ) + heapCLASS_TOO_SMALL( 7, xSize ) + heapCLASS_TOO_SMALL( 8, xSize ) +		\
+		  heapCLASS_TOO_SMALL( 9, xSize ) + heapCLASS_TOO_SMALL( 10, xSize ) + heapCLASS_TOO_SMALL( 11, xSize ) +	\
+		  heapCLASS_TOO_SMALL( 12, xSize ) + heapCLASS_TOO_SMALL( 13, xSize ) + heapCLASS_TOO_SMALL( 14, xSize ) +	\
+		  heapCLASS_TOO_SMALL( 15, xSize ) )
+
+	/* The pool sizes, which are also those used if pvPortMalloc() is called
+	before vPortPoolInit(). */
+	const size_t xSizeList[] = { configHEAP_POOL_CLASSES };
+
+#else
+
+/* The maximum number of pools that vPortPoolInit() accepts. */
+#ifndef configHEAP_MAXIMUM_POOL_NUM
+	#define configHEAP_MAXIMUM_POOL_NUM	10
+#endif
+
+#define heapMAXIMUM_POOL_NUM configHEAP_MAXIMUM_POOL_NUM
+
+#if( heapMAXIMUM_POOL_NUM > 255 )
+	#error configHEAP_MAXIMUM_POOL_NUM must fit in the uint8_t class lookup table
+#endif
+
+/* The pool sizes used if pvPortMalloc() is called before vPortPoolInit(). */
+const size_t xSizeList[] = { 80, 160, 240, 320, 400, 480, 560, 640, 720, 1000 };
+
+/* The largest request that can be served from a pool.  The class lookup table
+ * below holds one entry per portBYTE_ALIGNMENT bytes up to this size.
+ */
+#ifndef configHEAP_MAXIMUM_POOL_BLOCK_SIZE
+	#define configHEAP_MAXIMUM_POOL_BLOCK_SIZE	1024
+#endif
+
+#define heapPOOL_INDEX_OF( xSize )	( ( ( xSize ) + portBYTE_ALIGNMENT_MASK ) / portBYTE_ALIGNMENT )
+#define heapPOOL_INDEX_SIZE			( heapPOOL_INDEX_OF( configHEAP_MAXIMUM_POOL_BLOCK_SIZE ) + 1 )
+
+/* The pool for a request, or heapMAXIMUM_POOL_NUM if no pool can hold it. */
+#define heapPOOL_CLASS_OF( xSize )	( ( ( xSize ) <= configHEAP_MAXIMUM_POOL_BLOCK_SIZE ) ? ( size_t ) ucPoolIndex[ heapPOOL_INDEX_OF( xSize ) ] : ( size_t ) heapMAXIMUM_POOL_NUM )
+
+#endif /* configHEAP_POOL_CLASSES */
+
+#define heapDEFAULT_POOL_NUM	( sizeof( xSizeList ) / sizeof( xSizeList[ 0 ] ) )
+
+#if( configHEAP_USE_SPANS == 1 ) && ( configHEAP_MAXIMUM_POOL_BLOCK_SIZE > ( heapSPAN_MAX_PAGES * configHEAP_SPAN_PAGE_SIZE ) )
+	#error configHEAP_MAXIMUM_POOL_BLOCK_SIZE must fit in a span of heapSPAN_MAX_PAGES pages
+#endif
+
+static BaseType_t xHeapHasBeenInitialised = pdFALSE;
+static BaseType_t xPoolHasBeenInitialised = pdFALSE;
+
+/* Create a couple of pools. */
+static Pool_t xPool[heapMAXIMUM_POOL_NUM];
+static size_t xPoolCount = 0;
+
+#ifndef configHEAP_POOL_CLASSES
+
+/* Maps a request size, in units of portBYTE_ALIGNMENT, to the index of the
+ * smallest pool that can hold it.  heapMAXIMUM_POOL_NUM marks sizes that no
+ * pool can serve.  Built by prvPoolInit() so that pvPortMalloc() does not
+ * have to scan xPool[] with the scheduler suspended.
+ */
+static uint8_t ucPoolIndex[heapPOOL_INDEX_SIZE];
+
+#else
+
+/* A free block must still be able to hold its list link. */
+typedef char heapSMALLEST_CLASS_HOLDS_A_BLOCK_t[ ( heapCLASS( 0 ) >= sizeof( Block_t ) ) ? 1 : -1 ];
+
+/* The list can not end in a 0 either, as that would add a pool past the
+classes. */
+typedef char heapCLASS_LIST_HAS_NO_ZERO_t[ ( heapDEFAULT_POOL_NUM == heapCLASS_COUNT ) ? 1 : -1 ];
+
+#endif /* configHEAP_POOL_CLASSES */
+
+/* Head of the free large block list.  The list is terminated by NULL. */
+static LargeBlock_t xLargeStart = { 0, NULL };
+
+/* The regions of the heap, in address order.  Fresh blocks are never carved
+beyond pucHeapEnd.  With spans large blocks are carved downwards from there, so
+it then marks the bottom of the large block region.  Heap snapshots and the
+span page map give addresses relative to xRegion[ 0 ].pucHeapStart. */
+static Region_t xRegion[ heapMAXIMUM_REGION_NUM ];
+static size_t xRegionCount = 0;
+
+/* The total size of all the regions, after alignment. */
+static size_t xTotalHeapSize = 0;
+
+#if( configHEAP_USE_SPANS == 1 )
+
+	/* The pool index of every page that has been carved into a span. */
+	static uint8_t ucSpanMap[ heapSPAN_PAGE_COUNT ];
+
+	/* One bit per page, set for the first page of each span.  A span can be
+	next to another of the same pool, so the map alone does not say where one
+	ends. */
+	static uint32_t ulSpanStarts[ ( heapSPAN_PAGE_COUNT + 31 ) / 32 ];
+
+	#define heapSPAN_START_WORD( pv )		( ulSpanStarts[ heapPAGE_OF( pv ) / 32 ] )
+	#define heapSPAN_START_BIT( pv )		( ( uint32_t ) 1 << ( heapPAGE_OF( pv ) % 32 ) )
+	#define heapIS_SPAN_START( pv )			( ( heapSPAN_START_WORD( pv ) & heapSPAN_START_BIT( pv ) ) != 0 )
+
+	/* Spans given back by their pools, free for any pool to carve again.  The
+	runs of pages are kept in address order, with neighbours merged, each with
+	its length stored in its first page.  Protected in the same way as the
+	unallocated heap.  These bytes are still counted in xFreeBytesRemaining. */
+	typedef struct SpanRun
+	{
+		struct SpanRun *pxNextRun;	/* The next run up the heap. */
+		size_t xPages;				/* The number of pages in this run. */
+	} SpanRun_t;
+
+	static SpanRun_t *pxSpanReserve = NULL;
+	static size_t xSpanReserveBytes = 0;
+
+	/* A run is at least one page, which must be able to hold its header. */
+	typedef char heapSPAN_PAGE_HOLDS_A_RUN_t[ ( configHEAP_SPAN_PAGE_SIZE >= sizeof( SpanRun_t ) ) ? 1 : -1 ];
+
+#endif
+
+/* Pool free lists, and xFreeBytesRemaining, can also be changed by
+pvPortMallocFromISR() and vPortFreeFromISR(), which suspending the scheduler
+does not keep out.  When that API is in use every pool list operation is
+wrapped in a short critical section. */
+#ifndef configHEAP_USE_ISR_API
+	#define configHEAP_USE_ISR_API	0
+#endif
+
+/* When configHEAP_USE_POOL_LOCKS is 1 the pool path does not suspend the
+scheduler at all.  Each pool list operation, and each carve from the
+unallocated heap, is instead a critical section held only for the pointer
+swap.  The large block list, which has to be walked, is still protected by
+suspending the scheduler. */
+#ifndef configHEAP_USE_POOL_LOCKS
+	#define configHEAP_USE_POOL_LOCKS	configHEAP_USE_LOCK_FREE_POOLS
+#endif
+
+#if( configHEAP_USE_LOCK_FREE_POOLS == 1 ) && ( configHEAP_USE_POOL_LOCKS == 0 )
+	#error configHEAP_USE_LOCK_FREE_POOLS keeps the scheduler running on the pool path, so needs configHEAP_USE_POOL_LOCKS
+#endif
+
+#if( configHEAP_USE_LOCK_FREE_POOLS == 1 )
+	/* The lists and counters are atomic, so there is nothing to lock. */
+	#define heapPOOL_LOCK()
+	#define heapPOOL_UNLOCK()
+	#define heapPOOL_LOCK_FROM_ISR()			( ( UBaseType_t ) 0 )
+	#define heapPOOL_UNLOCK_FROM_ISR( uxSaved )	( void ) ( uxSaved )
+#elif( ( configHEAP_USE_ISR_API == 1 ) || ( configHEAP_USE_POOL_LOCKS == 1 ) )
+	#define heapPOOL_LOCK()		taskENTER_CRITICAL()
+	#define heapPOOL_UNLOCK()	taskEXIT_CRITICAL()
+	#define heapPOOL_LOCK_FROM_ISR()			taskENTER_CRITICAL_FROM_ISR()
+	#define heapPOOL_UNLOCK_FROM_ISR( uxSaved )	taskEXIT_CRITICAL_FROM_ISR( uxSaved )
+#else
+	#define heapPOOL_LOCK()
+	#define heapPOOL_UNLOCK()
+	#define heapPOOL_LOCK_FROM_ISR()			taskENTER_CRITICAL_FROM_ISR()
+	#define heapPOOL_UNLOCK_FROM_ISR( uxSaved )	taskEXIT_CRITICAL_FROM_ISR( uxSaved )
+#endif
+
+#if( configHEAP_USE_POOL_LOCKS == 1 )
+	#define heapBUMP_LOCK()			taskENTER_CRITICAL()
+	#define heapBUMP_UNLOCK()		taskEXIT_CRITICAL()
+	#define heapMALLOC_SUSPEND()
+	#define heapMALLOC_RESUME()
+	#define heapLARGE_SUSPEND()		vTaskSuspendAll()
+	#define heapLARGE_RESUME()		( void ) xTaskResumeAll()
+#else
+	#define heapBUMP_LOCK()
+	#define heapBUMP_UNLOCK()
+	#define heapMALLOC_SUSPEND()	vTaskSuspendAll()
+	#define heapMALLOC_RESUME()		( void ) xTaskResumeAll()
+	#define heapLARGE_SUSPEND()
+	#define heapLARGE_RESUME()
+#endif
+
+/* configHEAP_USE_TIMING times the sections that really run with the scheduler
+suspended, so with configHEAP_USE_POOL_LOCKS only the large block paths. */
+#if( configHEAP_USE_POOL_LOCKS == 1 )
+	#define heapMALLOC_TIMING_START( uxSection )
+	#define heapMALLOC_TIMING_STOP( uxSection )
+	#define heapLARGE_TIMING_START( uxSection )		portHEAP_TIMING_START( uxSection )
+	#define heapLARGE_TIMING_STOP( uxSection )		portHEAP_TIMING_STOP( uxSection )
+#else
+	#define heapMALLOC_TIMING_START( uxSection )	portHEAP_TIMING_START( uxSection )
+	#define heapMALLOC_TIMING_STOP( uxSection )		portHEAP_TIMING_STOP( uxSection )
+	#define heapLARGE_TIMING_START( uxSection )
+	#define heapLARGE_TIMING_STOP( uxSection )
+#endif
+
+/* A task that calls xPortTaskCacheCreate() gets a private free list for every
+pool, reached through one of its thread local storage pointers.  Allocations
+and frees by that task are served from the private lists without any locking.
+Blocks move to and from the shared pools configHEAP_TASK_CACHE_BATCH at a time
+when a private list runs empty or grows past configHEAP_TASK_CACHE_DEPTH, and
+a cache never holds more than configHEAP_TASK_CACHE_MAX_BYTES in all, so pools
+with blocks larger than that are not cached at all.  Blocks held in a task
+cache are not counted by xPortGetFreeHeapSize(), and are given back before
+pvPortMalloc() fails for the task that holds them. */
+#if( configHEAP_USE_TASK_CACHE == 1 )
+
+	#if( configNUM_THREAD_LOCAL_STORAGE_POINTERS == 0 )
+		#error configHEAP_USE_TASK_CACHE requires configNUM_THREAD_LOCAL_STORAGE_POINTERS to be at least 1
+	#endif
+
+	#ifndef configHEAP_TASK_CACHE_TLS_INDEX
+		#define configHEAP_TASK_CACHE_TLS_INDEX	0
+	#endif
+
+	#ifndef configHEAP_TASK_CACHE_DEPTH
+		#define configHEAP_TASK_CACHE_DEPTH		16
+	#endif
+
+	#ifndef configHEAP_TASK_CACHE_BATCH
+		#define configHEAP_TASK_CACHE_BATCH		( configHEAP_TASK_CACHE_DEPTH / 2 )
+	#endif
+
+	#if( ( configHEAP_TASK_CACHE_DEPTH > 255 ) || ( configHEAP_TASK_CACHE_BATCH == 0 ) || ( configHEAP_TASK_CACHE_BATCH > configHEAP_TASK_CACHE_DEPTH ) )
+		#error configHEAP_TASK_CACHE_BATCH must be between 1 and configHEAP_TASK_CACHE_DEPTH, which must be at most 255
+	#endif
+
+	#ifndef configHEAP_TASK_CACHE_MAX_BYTES
+		#define configHEAP_TASK_CACHE_MAX_BYTES	1024
+	#endif
+
+	typedef struct TaskCache
+	{
+		Block_t *pxFirstFree[ heapMAXIMUM_POOL_NUM ];	/* The cached free blocks of each pool. */
+		uint8_t ucCount[ heapMAXIMUM_POOL_NUM ];		/* The number of blocks on each list. */
+		size_t xAllocations[ heapMAXIMUM_POOL_NUM ];	/* Allocations served since the last refill. */
+		size_t xRequestedBytes[ heapMAXIMUM_POOL_NUM ];	/* The bytes those allocations asked for. */
+		size_t xCachedBytes;							/* The bytes held on all the lists. */
+	} TaskCache_t;
+
+	/* Set once any task has a cache, so pvPortMalloc() calls made before the
+	first task runs never read a thread local storage pointer. */
+	static BaseType_t xTaskCacheInUse = pdFALSE;
+
+	#define heapGET_TASK_CACHE()	( ( TaskCache_t * ) pvTaskGetThreadLocalStoragePointer( NULL, configHEAP_TASK_CACHE_TLS_INDEX ) )
+
+#endif /* configHEAP_USE_TASK_CACHE */
+
+/* An object pool made by xPortObjectPoolCreate() is one allocation from the
+heap, the ObjectPool_t followed by all of its objects.  Its Pool_t keeps the
+free objects and the counts the same way a size class does, but the objects
+carry no header - the caller passes the pool back with each one - so neither
+the size class lookup nor heapPOOL_OF() is needed to serve or take one. */
+#ifndef configHEAP_USE_OBJECT_POOLS
+	#define configHEAP_USE_OBJECT_POOLS	0
+#endif
+
+/* When configHEAP_PRIVATE_OBJECT_POOLS is 1 every object pool is used by only
+one task, so taking and giving an object is the bare list pop or push.
+Otherwise it is protected as the pool path is, by suspending the scheduler or,
+with configHEAP_USE_POOL_LOCKS, by the pool lock. */
+#ifndef configHEAP_PRIVATE_OBJECT_POOLS
+	#define configHEAP_PRIVATE_OBJECT_POOLS	0
+#endif
+
+#if( configHEAP_USE_OBJECT_POOLS == 1 )
+
+	#if( configHEAP_PRIVATE_OBJECT_POOLS == 1 )
+		#define heapOBJECT_SUSPEND()
+		#define heapOBJECT_RESUME()
+		#define heapOBJECT_LOCK()
+		#define heapOBJECT_UNLOCK()
+	#else
+		#define heapOBJECT_SUSPEND()	heapMALLOC_SUSPEND()
+		#define heapOBJECT_RESUME()		heapMALLOC_RESUME()
+		#define heapOBJECT_LOCK()		heapPOOL_LOCK()
+		#define heapOBJECT_UNLOCK()		heapPOOL_UNLOCK()
+	#endif
+
+	typedef struct ObjectPool
+	{
+		Pool_t xObjects;		/* The free objects, xBlockSize is the stride between them. */
+		uint8_t *pucObjects;	/* The first object. */
+	} ObjectPool_t;
+
+	#define heapOBJECT_POOL_HEADER_SIZE	( ( sizeof( ObjectPool_t ) + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK ) )
+
+	/* Free objects hold the free list link where a Block_t keeps it. */
+	#define heapOBJECT_MINIMUM_STRIDE	( ( sizeof( Block_t ) + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK ) )
+
+#endif /* configHEAP_USE_OBJECT_POOLS */
+
+/* The number of bytes not yet carved from pxArea, and whether xSize of them
+can still be carved. */
+#define heapUNCARVED_BYTES( pxArea )		( ( size_t ) ( ( pxArea )->pucHeapEnd - ( uint8_t * ) ( pxArea )->pxFreeHeap ) )
+#define heapCAN_CARVE( pxArea, xSize )	( heapUNCARVED_BYTES( pxArea ) >= ( xSize ) )
+
+/* Keeps track of the number of free bytes remaining, but says nothing about
+fragmentation.  Both are set when the heap is initialised. */
+static size_t xFreeBytesRemaining = 0;
+static size_t xMinimumEverFreeBytesRemaining = 0;
+
+/* The number of large blocks currently allocated. */
+static size_t xLargeBlocksInUse = 0;
+
+/* Add to or take from a counter the pools share, evaluating to its new value,
+and move a watermark on to xValue if it is further out.  Must be called with
+the pool lock held. */
+#if( configHEAP_USE_LOCK_FREE_POOLS == 1 )
+
+	#define heapCOUNTER_ADD( xCounter, xDelta )		configHEAP_ATOMIC_ADD( &( xCounter ), ( size_t ) ( xDelta ) )
+	#define heapCOUNTER_SUB( xCounter, xDelta )		configHEAP_ATOMIC_ADD( &( xCounter ), -( size_t ) ( xDelta ) )
+
+	#define heapRAISE_WATERMARK( xWatermark, xValue )									\
+	{																					\
+		size_t xSeen = ( xWatermark );													\
+		while( ( xSeen < ( xValue ) ) && !configHEAP_ATOMIC_CAS( &( xWatermark ), xSeen, ( xValue ) ) )	\
+		{																				\
+			xSeen = ( xWatermark );														\
+		}																				\
+	}
+
+	#define heapLOWER_WATERMARK( xWatermark, xValue )									\
+	{																					\
+		size_t xSeen = ( xWatermark );													\
+		while( ( xSeen > ( xValue ) ) && !configHEAP_ATOMIC_CAS( &( xWatermark ), xSeen, ( xValue ) ) )	\
+		{																				\
+			xSeen = ( xWatermark );														\
+		}																				\
+	}
+
+#else
+
+	#define heapCOUNTER_ADD( xCounter, xDelta )		( ( xCounter ) += ( xDelta ) )
+	#define heapCOUNTER_SUB( xCounter, xDelta )		( ( xCounter ) -= ( xDelta ) )
+
+	#define heapRAISE_WATERMARK( xWatermark, xValue )									\
+	{																					\
+		if( ( xWatermark ) < ( xValue ) )												\
+		{																				\
+			( xWatermark ) = ( xValue );												\
+		}																				\
+	}
+
+	#define heapLOWER_WATERMARK( xWatermark, xValue )									\
+	{																					\
+		if( ( xWatermark ) > ( xValue ) )												\
+		{																				\
+			( xWatermark ) = ( xValue );												\
+		}																				\
+	}
+
+#endif /* configHEAP_USE_LOCK_FREE_POOLS */
+
+/* Take xBytes from xFreeBytesRemaining.  Must be called with the pool lock
+held. */
+#define heapTAKE_FREE_BYTES( xBytes )													\
+{																						\
+	const size_t xNowFree = heapCOUNTER_SUB( xFreeBytesRemaining, ( xBytes ) );		\
+	heapLOWER_WATERMARK( xMinimumEverFreeBytesRemaining, xNowFree );					\
+}
+
+/* Move xCount blocks of pxOwner off, or back on to, its free list in the
+accounting.  Must be called with the pool lock held. */
+#define heapPOOL_TAKE_BLOCKS( pxOwner, xCount )											\
+{																						\
+	const size_t xNowInUse = heapCOUNTER_ADD( ( pxOwner )->xBlocksInUse, ( xCount ) );	\
+	heapRAISE_WATERMARK( ( pxOwner )->xMaxBlocksInUse, xNowInUse );					\
+	heapTAKE_FREE_BYTES( ( xCount ) * ( pxOwner )->xBlockSize );						\
+}
+
+/* As heapPOOL_TAKE_BLOCKS(), but the watermarks are left alone, for a batch that
+may yet be given back.  heapPOOL_MARK_WATERMARKS() moves them on once it is
+kept.  Both must be called with the pool lock held. */
+#define heapPOOL_CLAIM_BLOCKS( pxOwner, xCount )										\
+{																						\
+	( void ) heapCOUNTER_ADD( ( pxOwner )->xBlocksInUse, ( xCount ) );				\
+	( void ) heapCOUNTER_SUB( xFreeBytesRemaining, ( xCount ) * ( pxOwner )->xBlockSize );	\
+}
+
+#define heapPOOL_MARK_WATERMARKS( pxOwner )												\
+{																						\
+	heapRAISE_WATERMARK( ( pxOwner )->xMaxBlocksInUse, ( pxOwner )->xBlocksInUse );	\
+	heapLOWER_WATERMARK( xMinimumEverFreeBytesRemaining, xFreeBytesRemaining );		\
+}
+
+#define heapPOOL_RETURN_BLOCKS( pxOwner, xCount )										\
+{																						\
+	( void ) heapCOUNTER_ADD( xFreeBytesRemaining, ( xCount ) * ( pxOwner )->xBlockSize );	\
+	( void ) heapCOUNTER_SUB( ( pxOwner )->xBlocksInUse, ( xCount ) );				\
+}
+
+/* Record xCount allocations of xRequestedSize bytes served by pxOwner.  Must be
+called with the pool lock held. */
+#define heapPOOL_COUNT_ALLOCATIONS( pxOwner, xCount, xRequestedSize )					\
+{																						\
+	( void ) heapCOUNTER_ADD( ( pxOwner )->xAllocations, ( xCount ) );					\
+	( void ) heapCOUNTER_ADD( ( pxOwner )->xRoundingWaste, ( xCount ) * ( ( pxOwner )->xBlockSize - ( xRequestedSize ) ) );	\
+}
+
+/* Pop the first block of pxOwner's free list into pxBlock, which is NULL if
+the list is empty, push the chain pxFirst to pxLast onto it, take the whole
+list into pxList, or read its first block without taking it.  Must be called
+with the pool lock held. */
+#if( configHEAP_USE_LOCK_FREE_POOLS == 1 )
+
+	#define heapPOOL_POP( pxOwner, pxBlock )			( pxBlock ) = prvPoolPop( pxOwner )
+	#define heapPOOL_PUSH( pxOwner, pxFirst, pxLast )	prvPoolPush( ( pxOwner ), ( pxFirst ), ( pxLast ) )
+	#define heapPOOL_DETACH( pxOwner, pxList )			( pxList ) = prvPoolDetach( pxOwner )
+	#define heapPOOL_FIRST( pxOwner )					heapHEAD_BLOCK( ( pxOwner )->xFirstFree )
+
+	/* A tagged head holds the index of the first block, counted from the start
+	of the heap in portBYTE_ALIGNMENT units plus one so that 0 means empty, in
+	its low bits and the tag in the bits above.  heapHEAD_INDEX_MASK covers
+	every index the heap can need. */
+	#define heapSMEAR_1( x )		( ( x ) | ( ( x ) >> 1 ) )
+	#define heapSMEAR_2( x )		( heapSMEAR_1( x ) | ( heapSMEAR_1( x ) >> 2 ) )
+	#define heapSMEAR_4( x )		( heapSMEAR_2( x ) | ( heapSMEAR_2( x ) >> 4 ) )
+	#define heapSMEAR_8( x )		( heapSMEAR_4( x ) | ( heapSMEAR_4( x ) >> 8 ) )
+	#define heapSMEAR_16( x )		( heapSMEAR_8( x ) | ( heapSMEAR_8( x ) >> 16 ) )
+	#define heapHEAD_INDEX_MASK		( ( size_t ) heapSMEAR_16( ( size_t ) ( configADJUSTED_HEAP_SIZE / portBYTE_ALIGNMENT ) + 1 ) )
+	#define heapHEAD_TAG_ONE		( heapHEAD_INDEX_MASK + 1 )
+
+	#define heapHEAD_BLOCK( xHead )													\
+		( ( ( ( xHead ) & heapHEAD_INDEX_MASK ) == 0 ) ? NULL :						\
+		  ( Block_t * ) ( void * ) ( xRegion[ 0 ].pucHeapStart + ( ( ( ( xHead ) & heapHEAD_INDEX_MASK ) - 1 ) * portBYTE_ALIGNMENT ) ) )
+
+	/* The head that follows xHead when pxBlock becomes the first block. */
+	#define heapHEAD_NEXT( xHead, pxBlock )											\
+		( ( ( ( xHead ) & ~heapHEAD_INDEX_MASK ) + heapHEAD_TAG_ONE ) |			\
+		  ( ( ( pxBlock ) == NULL ) ? 0 : ( ( ( ( size_t ) ( ( uint8_t * ) ( pxBlock ) - xRegion[ 0 ].pucHeapStart ) / portBYTE_ALIGNMENT ) + 1 ) & heapHEAD_INDEX_MASK ) ) )
+
+	/* The tag must be wide enough that it does not come round to the same
+	value while a pop is between reading the head and swapping it. */
+	typedef char heapHEAD_HAS_TAG_BITS_t[ ( heapHEAD_INDEX_MASK <= ( ( ( size_t ) -1 ) >> 16 ) ) ? 1 : -1 ];
+
+	/*
+	 * The compare and swap loops behind heapPOOL_POP(), heapPOOL_PUSH() and
+	 * heapPOOL_DETACH().
+	 */
+	static Block_t *prvPoolPop( Pool_t *pxOwner );
+	static void prvPoolPush( Pool_t *pxOwner, Block_t *pxFirst, Block_t *pxLast );
+	static Block_t *prvPoolDetach( Pool_t *pxOwner );
+
+#else
+
+	#define heapPOOL_POP( pxOwner, pxBlock )											\
+	{																					\
+		( pxBlock ) = ( pxOwner )->pxFirstFree;											\
+		if( ( pxBlock ) != NULL )														\
+		{																				\
+			( pxOwner )->pxFirstFree = ( pxBlock )->pxNext;							\
+		}																				\
+	}
+
+	#define heapPOOL_PUSH( pxOwner, pxFirst, pxLast )									\
+	{																					\
+		( pxLast )->pxNext = ( pxOwner )->pxFirstFree;									\
+		( pxOwner )->pxFirstFree = ( pxFirst );											\
+	}
+
+	#define heapPOOL_DETACH( pxOwner, pxList )											\
+	{																					\
+		( pxList ) = ( pxOwner )->pxFirstFree;											\
+		( pxOwner )->pxFirstFree = NULL;												\
+	}
+
+	#define heapPOOL_FIRST( pxOwner )					( ( pxOwner )->pxFirstFree )
+
+#endif /* configHEAP_USE_LOCK_FREE_POOLS */
+
+/* STATIC FUNCTIONS ARE DEFINED AS MACROS TO MINIMIZE THE FUNCTION CALL DEPTH. */
+
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+void *pvReturn = NULL;
+Block_t *pxBlock;
+size_t iter = heapMAXIMUM_POOL_NUM;
+const size_t xRequestedSize = xWantedSize;
+
+	heapGUARD_GROW( xWantedSize );
+
+	#if( configHEAP_USE_TASK_CACHE == 1 )
+	{
+		/* Blocks already held by the calling task need no locking at all. */
+		pvReturn = prvTaskCacheAllocate( xWantedSize );
+		if( pvReturn != NULL )
+		{
+			portHEAP_TAG_RECORD( pvReturn, heapPOOL_OF( heapUSER_TO_BLOCK( pvReturn ) )->xBlockSize );
+			heapGUARD_ARM( pvReturn, xRequestedSize );
+			portHEAP_TRACE_MALLOC( pvReturn, xRequestedSize );
+			return pvReturn;
+		}
+	}
+	#endif
+
+	/* If this is the first call to malloc then the heap will require
+	initialization. */
+	prvEnsureInitialised();
+
+	heapMALLOC_SUSPEND();
+	heapMALLOC_TIMING_START( portHEAP_TIMING_MALLOC );
+	{
+
+		/* The wanted size is increased so it can contain a Block_t
+		structure in addition to the requested amount of bytes. */
+		if( xWantedSize > 0 )
+		{
+            /* Find the best-fit size from the pool size. */
+            iter = heapPOOL_CLASS_OF(xWantedSize);
+
+            if (iter < heapMAXIMUM_POOL_NUM) {
+                /* Ensure that blocks are always aligned to the required number of bytes. */
+                xWantedSize = heapPOOL_STRIDE(xPool[iter].xBlockSize);
+            } else if (xWantedSize <= xTotalHeapSize) {
+                /* No pool is large enough to hold the request, it will be
+                served from the large block list instead. */
+                xWantedSize += heapSTRUCT_SIZE;
+
+                if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0 )
+                {
+                    xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+                }
+            } else {
+                xWantedSize = 0;
+            }
+		}
+
+		if( ( xWantedSize > 0 ) && ( xWantedSize < xFreeBytesRemaining ) )
+		{
+            if (iter == heapMAXIMUM_POOL_NUM) {
+
+                heapLARGE_SUSPEND();
+                heapLARGE_TIMING_START(portHEAP_TIMING_MALLOC);
+                pvReturn = prvAllocateLargeBlock(xWantedSize, heapALL_REGIONS);
+                heapLARGE_TIMING_STOP(portHEAP_TIMING_MALLOC);
+                heapLARGE_RESUME();
+
+            } else {
+
+                heapPOOL_LOCK();
+                {
+                    /* The block is being returned for use so must be taken
+                    out of the list of free blocks. */
+                    heapPOOL_POP(&(xPool[iter]), pxBlock);
+                    if (pxBlock != NULL) {
+                        heapPOOL_TAKE_BLOCKS(&(xPool[iter]), 1);
+                        heapPOOL_COUNT_ALLOCATIONS(&(xPool[iter]), 1, xRequestedSize);
+                    }
+                }
+                heapPOOL_UNLOCK();
+
+                #if( configHEAP_USE_SPANS == 1 )
+                {
+                    /* Give the pool a fresh span and try again. */
+                    if ((pxBlock == NULL) && (prvCarveSpan(iter) == pdTRUE)) {
+                        heapPOOL_LOCK();
+                        {
+                            heapPOOL_POP(&(xPool[iter]), pxBlock);
+                            if (pxBlock != NULL) {
+                                heapPOOL_TAKE_BLOCKS(&(xPool[iter]), 1);
+                                heapPOOL_COUNT_ALLOCATIONS(&(xPool[iter]), 1, xRequestedSize);
+                            }
+                        }
+                        heapPOOL_UNLOCK();
+                    }
+                }
+                #else
+                {
+                    if (pxBlock == NULL) {
+                        /* Take a new block from the unallocated heap, in the
+                        pool's own region if it still has room. */
+                        pxBlock = prvCarve(xPool[iter].xRegion, heapALL_REGIONS, xWantedSize);
+
+                        if (pxBlock != NULL) {
+                            heapSET_POOL(pxBlock, &(xPool[iter]));
+
+                            heapPOOL_LOCK();
+                            (void) heapCOUNTER_ADD(xPool[iter].xBlocksCarved, 1);
+                            heapPOOL_TAKE_BLOCKS(&(xPool[iter]), 1);
+                            heapPOOL_COUNT_ALLOCATIONS(&(xPool[iter]), 1, xRequestedSize);
+                            heapPOOL_UNLOCK();
+                        }
+                    }
+                }
+                #endif
+
+                if (pxBlock != NULL) {
+                    /* Return the memory space - jumping over the Block_t
+                    structure at its start. */
+                    pvReturn = heapBLOCK_TO_USER(pxBlock);
+                    portHEAP_TAG_RECORD(pvReturn, xPool[iter].xBlockSize);
+                }
+            }
+		}
+	}
+	heapMALLOC_TIMING_STOP( portHEAP_TIMING_MALLOC );
+	heapMALLOC_RESUME();
+
+	#if( configHEAP_USE_TASK_CACHE == 1 )
+	{
+		/* The blocks parked in the calling task's cache may be what the heap
+		is short of, so give them back and try once more before failing. */
+		if( ( pvReturn == NULL ) && ( xRequestedSize > 0 ) && ( prvTaskCacheFlush() == pdTRUE ) )
+		{
+			return pvPortMalloc( xRequestedSize );
+		}
+	}
+	#endif
+
+	heapGUARD_ARM( pvReturn, xRequestedSize );
+	portHEAP_TRACE_MALLOC( pvReturn, xRequestedSize );
+
+	#if( configHEAP_USE_RECLAIM == 1 )
+	{
+		if( pvReturn != NULL )
+		{
+			vPortHeapReclaimCheck( portHEAP_RECLAIM_HEAP, xFreeBytesRemaining );
+			if( iter < heapMAXIMUM_POOL_NUM )
+			{
+				vPortHeapReclaimCheck( iter, prvPoolBlocksAvailable( iter ) );
+			}
+		}
+		else if( ( xRequestedSize > 0 ) && ( xPortHeapReclaimBegin( ( iter < heapMAXIMUM_POOL_NUM ) ? iter : portHEAP_RECLAIM_HEAP ) == pdTRUE ) )
+		{
+			/* The callbacks may have freed enough, so try once more.  The
+			retry calls the malloc failed hook if it fails too. */
+			pvReturn = pvPortMalloc( xRequestedSize );
+			vPortHeapReclaimEnd();
+			return pvReturn;
+		}
+	}
+	#endif
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+Block_t *pxLink;
+Pool_t *pxOwner;
+
+	if( ( pv != NULL ) && heapGUARD_RELEASE( pv ) )
+	{
+		portHEAP_TRACE_FREE( pv );
+
+		if( heapIS_LARGE_BLOCK( pv ) )
+		{
+			heapMALLOC_SUSPEND();
+			heapMALLOC_TIMING_START( portHEAP_TIMING_FREE );
+			prvFreeLargeBlock( ( void * ) ( ( uint8_t * ) pv - heapSTRUCT_SIZE ) );
+			heapMALLOC_TIMING_STOP( portHEAP_TIMING_FREE );
+			heapMALLOC_RESUME();
+		}
+		else
+		{
+			/* The memory being freed will have an Block_t structure
+			immediately before it, or at it if pool blocks have no header. */
+			pxLink = heapUSER_TO_BLOCK( pv );
+
+			portHEAP_TAG_FORGET( pv );
+
+			#if( configHEAP_USE_TASK_CACHE == 1 )
+			{
+				if( prvTaskCacheFree( pxLink ) == pdTRUE )
+				{
+					return;
+				}
+			}
+			#endif
+
+			heapMALLOC_SUSPEND();
+			heapMALLOC_TIMING_START( portHEAP_TIMING_FREE );
+			{
+				/* Add this block to the list of free blocks. */
+				pxOwner = heapPOOL_OF( pxLink );
+
+				heapPOOL_LOCK();
+				{
+					heapPOOL_PUSH( pxOwner, pxLink, pxLink );
+					heapPOOL_RETURN_BLOCKS( pxOwner, 1 );
+				}
+				heapPOOL_UNLOCK();
+			}
+			heapMALLOC_TIMING_STOP( portHEAP_TIMING_FREE );
+			heapMALLOC_RESUME();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMallocBatch( size_t xWantedSize, size_t xCount, void *ppvBlocks[] )
+{
+void *pvReturn = NULL;
+size_t iter = heapMAXIMUM_POOL_NUM;
+size_t xTaken = 0;
+const size_t xRequestedSize = xWantedSize;
+
+	heapGUARD_GROW( xWantedSize );
+	prvEnsureInitialised();
+
+	if( xWantedSize > 0 )
+	{
+		iter = heapPOOL_CLASS_OF( xWantedSize );
+	}
+
+	if( ( xWantedSize > 0 ) && ( xCount > 0 ) && ( ppvBlocks != NULL ) )
+	{
+		heapMALLOC_SUSPEND();
+		{
+			if( iter < heapMAXIMUM_POOL_NUM )
+			{
+				/* Detach as much as possible from the free list in one go. */
+				xTaken = prvPopBlocks( iter, ppvBlocks, xCount );
+
+				#if( configHEAP_USE_SPANS == 1 )
+				{
+					/* Keep adding spans to the pool until it can cover the
+					rest. */
+					while( ( xTaken < xCount ) && ( prvCarveSpan( iter ) == pdTRUE ) )
+					{
+						xTaken += prvPopBlocks( iter, &( ppvBlocks[ xTaken ] ), xCount - xTaken );
+					}
+				}
+				#else
+				{
+				size_t xStride = heapPOOL_STRIDE( xPool[ iter ].xBlockSize );
+				size_t xCarved = xCount - xTaken;
+				Block_t *pxBlock = NULL;
+
+					/* Then carve the rest as one contiguous run. */
+
+					if( ( xCarved > 0 ) && ( xCarved <= xTotalHeapSize / xStride ) )
+					{
+						pxBlock = prvCarve( xPool[ iter ].xRegion, heapALL_REGIONS, xCarved * xStride );
+					}
+
+					if( pxBlock != NULL )
+					{
+						for( ; xTaken < xCount; ++xTaken )
+						{
+							heapSET_POOL( pxBlock, &( xPool[ iter ] ) );
+							ppvBlocks[ xTaken ] = heapBLOCK_TO_USER( pxBlock );
+							pxBlock = ( void * ) ( ( uint8_t * ) pxBlock + xStride );
+						}
+
+						heapPOOL_LOCK();
+						( void ) heapCOUNTER_ADD( xPool[ iter ].xBlocksCarved, xCarved );
+						heapPOOL_CLAIM_BLOCKS( &( xPool[ iter ] ), xCarved );
+						heapPOOL_UNLOCK();
+					}
+				}
+				#endif
+			}
+			else if( xWantedSize <= xTotalHeapSize )
+			{
+				xWantedSize += heapSTRUCT_SIZE;
+				if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0 )
+				{
+					xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+				}
+
+				heapLARGE_SUSPEND();
+				{
+				const size_t xMinimumBefore = xMinimumEverFreeBytesRemaining;
+
+					while( xTaken < xCount )
+					{
+						ppvBlocks[ xTaken ] = prvAllocateLargeBlock( xWantedSize, heapALL_REGIONS );
+						if( ppvBlocks[ xTaken ] == NULL )
+						{
+							break;
+						}
+						++xTaken;
+					}
+
+					if( xTaken < xCount )
+					{
+						/* All or nothing.  Claiming the blocks recorded their
+						tags, so freeing them forgets them again, but they
+						were never traced.  The low watermark goes back to
+						where it was, unless the heap really has been lower
+						since. */
+						for( size_t i = 0; i < xTaken; ++i )
+						{
+							prvFreeLargeBlock( ( void * ) ( ( uint8_t * ) ppvBlocks[ i ] - heapSTRUCT_SIZE ) );
+						}
+
+						heapPOOL_LOCK();
+						{
+							xMinimumEverFreeBytesRemaining = xMinimumBefore;
+							heapLOWER_WATERMARK( xMinimumEverFreeBytesRemaining, xFreeBytesRemaining );
+						}
+						heapPOOL_UNLOCK();
+					}
+				}
+				heapLARGE_RESUME();
+			}
+
+			if( xTaken == xCount )
+			{
+				pvReturn = ppvBlocks[ 0 ];
+
+				#if( configHEAP_USE_GUARDS == 1 )
+				{
+					for( size_t i = 0; i < xCount; ++i )
+					{
+						prvGuardArm( ppvBlocks[ i ], xRequestedSize );
+					}
+				}
+				#endif
+
+				#if( configHEAP_USE_TRACE == 1 )
+				{
+					for( size_t i = 0; i < xCount; ++i )
+					{
+						portHEAP_TRACE_MALLOC( ppvBlocks[ i ], xRequestedSize );
+					}
+				}
+				#endif
+
+				if( iter < heapMAXIMUM_POOL_NUM )
+				{
+					heapPOOL_LOCK();
+					heapPOOL_MARK_WATERMARKS( &( xPool[ iter ] ) );
+					heapPOOL_COUNT_ALLOCATIONS( &( xPool[ iter ] ), xCount, xRequestedSize );
+					heapPOOL_UNLOCK();
+
+					#if( configHEAP_USE_ALLOCATION_TAGS == 1 )
+					{
+						/* Large blocks were recorded as they were claimed. */
+						for( size_t i = 0; i < xCount; ++i )
+						{
+							vPortHeapTagRecord( ppvBlocks[ i ], xPool[ iter ].xBlockSize );
+						}
+					}
+					#endif
+				}
+			}
+			else if( iter < heapMAXIMUM_POOL_NUM )
+			{
+				/* All or nothing - give back whatever was taken.  The large
+				block path has already done so. */
+				prvGiveBackBatch( iter, ppvBlocks, xTaken );
+			}
+		}
+		heapMALLOC_RESUME();
+	}
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFreeBatch( void *ppvBlocks[], size_t xCount )
+{
+Block_t *pxLink, *pxHead = NULL, *pxTail = NULL;
+size_t xChainLength = 0;
+
+	if( ppvBlocks != NULL )
+	{
+		heapMALLOC_SUSPEND();
+		{
+			/* Runs of blocks from the same pool are linked into a chain
+			privately and spliced onto the pool with a single lock. */
+			for( size_t i = 0; i < xCount; ++i )
+			{
+				if( ( ppvBlocks[ i ] != NULL ) && heapGUARD_RELEASE( ppvBlocks[ i ] ) )
+				{
+					portHEAP_TRACE_FREE( ppvBlocks[ i ] );
+
+					if( heapIS_LARGE_BLOCK( ppvBlocks[ i ] ) )
+					{
+						prvFreeLargeBlock( ( void * ) ( ( uint8_t * ) ppvBlocks[ i ] - heapSTRUCT_SIZE ) );
+					}
+					else
+					{
+						pxLink = heapUSER_TO_BLOCK( ppvBlocks[ i ] );
+						portHEAP_TAG_FORGET( ppvBlocks[ i ] );
+
+						if( ( pxHead != NULL ) && ( heapPOOL_OF( pxHead ) != heapPOOL_OF( pxLink ) ) )
+						{
+							prvPushChainToPool( pxHead, pxTail, xChainLength );
+							pxHead = NULL;
+							xChainLength = 0;
+						}
+
+						if( pxHead == NULL )
+						{
+							pxTail = pxLink;
+						}
+						pxLink->pxNext = pxHead;
+						pxHead = pxLink;
+						++xChainLength;
+					}
+				}
+			}
+
+			if( pxHead != NULL )
+			{
+				prvPushChainToPool( pxHead, pxTail, xChainLength );
+			}
+		}
+		heapMALLOC_RESUME();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMallocAligned( size_t xWantedSize, size_t xAlignment )
+{
+void *pvReturn = NULL;
+#if( configHEAP_USE_TRACE == 1 ) || ( configHEAP_USE_GUARDS == 1 )
+	const size_t xRequestedSize = xWantedSize;
+#endif
+
+	/* The alignment must be a power of two. */
+	configASSERT( ( xAlignment & ( xAlignment - 1 ) ) == 0 );
+
+	if( ( xAlignment <= portBYTE_ALIGNMENT ) || ( ( xAlignment & ( xAlignment - 1 ) ) != 0 ) )
+	{
+		/* Every block is already aligned this well. */
+		return ( ( xAlignment & ( xAlignment - 1 ) ) == 0 ) ? pvPortMalloc( xWantedSize ) : NULL;
+	}
+
+	heapGUARD_GROW( xWantedSize );
+	prvEnsureInitialised();
+
+	/* Pool blocks sit at a fixed stride, so only the large block list, which
+	can split a block anywhere, can honour an arbitrary alignment. */
+	if( ( xWantedSize > 0 ) && ( xWantedSize <= xTotalHeapSize ) && ( xAlignment <= xTotalHeapSize ) )
+	{
+		xWantedSize += heapSTRUCT_SIZE;
+		if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0 )
+		{
+			xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+		}
+
+		heapMALLOC_SUSPEND();
+		heapLARGE_SUSPEND();
+		{
+			pvReturn = prvAllocateAlignedLargeBlock( xWantedSize, xAlignment );
+		}
+		heapLARGE_RESUME();
+		heapMALLOC_RESUME();
+	}
+
+	heapGUARD_ARM( pvReturn, xRequestedSize );
+	portHEAP_TRACE_MALLOC( pvReturn, xRequestedSize );
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortRealloc( void *pv, size_t xWantedSize )
+{
+void *pvReturn = NULL;
+size_t xBlockSize, xLargeSize;
+BaseType_t xResized = pdFALSE;
+
+	if( pv == NULL )
+	{
+		return pvPortMalloc( xWantedSize );
+	}
+
+	if( xWantedSize == 0 )
+	{
+		vPortFree( pv );
+		return NULL;
+	}
+
+	if( heapGUARD_CHECK( pv ) == pdFALSE )
+	{
+		/* A damaged block is left as it is, as vPortFree() would. */
+		return NULL;
+	}
+
+	if( heapIS_LARGE_BLOCK( pv ) )
+	{
+		LargeBlock_t *pxBlock = ( void * ) ( ( uint8_t * ) pv - heapSTRUCT_SIZE );
+
+		xBlockSize = ( pxBlock->xBlockSize & ~heapLARGE_BLOCK_BIT ) - heapSTRUCT_SIZE;
+
+		if( xWantedSize <= xTotalHeapSize )
+		{
+			xLargeSize = xWantedSize + heapSTRUCT_SIZE + portHEAP_GUARD_OVERHEAD;
+			if( ( xLargeSize & portBYTE_ALIGNMENT_MASK ) != 0 )
+			{
+				xLargeSize += ( portBYTE_ALIGNMENT - ( xLargeSize & portBYTE_ALIGNMENT_MASK ) );
+			}
+
+			heapMALLOC_SUSPEND();
+			heapLARGE_SUSPEND();
+			{
+				xResized = prvResizeLargeBlock( pxBlock, xLargeSize );
+			}
+			heapLARGE_RESUME();
+			heapMALLOC_RESUME();
+		}
+	}
+	else
+	{
+		/* A pool block stays where it is for as long as the new size still
+		fits it, even if a smaller pool would now do. */
+		xBlockSize = heapPOOL_OF( heapUSER_TO_BLOCK( pv ) )->xBlockSize;
+		xResized = ( portHEAP_GUARDED_SIZE( xWantedSize ) <= xBlockSize ) ? pdTRUE : pdFALSE;
+	}
+
+	if( xResized == pdTRUE )
+	{
+		pvReturn = pv;
+		heapGUARD_ARM( pv, xWantedSize );
+		portHEAP_TRACE_REALLOC( pv, xWantedSize );
+	}
+	else
+	{
+		/* The block has to move.  pvPortMalloc() calls the malloc failed hook
+		if there is no room, and pv is left as it was. */
+		pvReturn = pvPortMalloc( xWantedSize );
+		if( pvReturn != NULL )
+		{
+			memcpy( pvReturn, pv, ( xWantedSize < xBlockSize ) ? xWantedSize : xBlockSize );
+			vPortFree( pv );
+		}
+	}
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+#if( configHEAP_USE_ISR_API == 1 )
+
+	void *pvPortMallocFromISR( size_t xWantedSize )
+	{
+	void *pvReturn = NULL;
+	Block_t *pxBlock = NULL;
+	size_t iter = heapMAXIMUM_POOL_NUM;
+	UBaseType_t uxSavedInterruptStatus;
+	const size_t xRequestedSize = xWantedSize;
+
+		heapGUARD_GROW( xWantedSize );
+
+		/* Only sizes that map to a pool can be served, and only from blocks
+		already on that pool's free list.  The pools must have been set up
+		from task context first. */
+		if( ( xPoolHasBeenInitialised == pdTRUE ) && ( xWantedSize > 0 ) )
+		{
+			iter = heapPOOL_CLASS_OF( xWantedSize );
+		}
+
+		if( iter < heapMAXIMUM_POOL_NUM )
+		{
+			uxSavedInterruptStatus = heapPOOL_LOCK_FROM_ISR();
+			{
+				heapPOOL_POP( &( xPool[ iter ] ), pxBlock );
+				if( pxBlock != NULL )
+				{
+					heapPOOL_TAKE_BLOCKS( &( xPool[ iter ] ), 1 );
+					heapPOOL_COUNT_ALLOCATIONS( &( xPool[ iter ] ), 1, xRequestedSize );
+				}
+			}
+			heapPOOL_UNLOCK_FROM_ISR( uxSavedInterruptStatus );
+		}
+
+		if( pxBlock != NULL )
+		{
+			pvReturn = heapBLOCK_TO_USER( pxBlock );
+			portHEAP_TAG_RECORD_FROM_ISR( pvReturn, xPool[ iter ].xBlockSize );
+		}
+
+		heapGUARD_ARM( pvReturn, xRequestedSize );
+		portHEAP_TRACE_MALLOC_FROM_ISR( pvReturn, xRequestedSize );
+
+		return pvReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortFreeFromISR( void *pv )
+	{
+	Block_t *pxLink;
+	Pool_t *pxOwner;
+	UBaseType_t uxSavedInterruptStatus;
+
+		if( pv != NULL )
+		{
+			/* Large blocks are merged into an address ordered list, which is
+			too slow to walk from an interrupt. */
+			configASSERT( !heapIS_LARGE_BLOCK( pv ) );
+
+			if( !heapIS_LARGE_BLOCK( pv ) && heapGUARD_RELEASE( pv ) )
+			{
+				pxLink = heapUSER_TO_BLOCK( pv );
+				pxOwner = heapPOOL_OF( pxLink );
+				portHEAP_TAG_FORGET_FROM_ISR( pv );
+				portHEAP_TRACE_FREE_FROM_ISR( pv );
+
+				uxSavedInterruptStatus = heapPOOL_LOCK_FROM_ISR();
+				{
+					heapPOOL_PUSH( pxOwner, pxLink, pxLink );
+					heapPOOL_RETURN_BLOCKS( pxOwner, 1 );
+				}
+				heapPOOL_UNLOCK_FROM_ISR( uxSavedInterruptStatus );
+			}
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* configHEAP_USE_ISR_API */
+
+#if( configHEAP_USE_TASK_CACHE == 1 )
+
+	BaseType_t xPortTaskCacheCreate( void )
+	{
+	TaskCache_t *pxCache;
+	BaseType_t xReturn = pdFALSE;
+
+		if( heapGET_TASK_CACHE() == NULL )
+		{
+			/* The cache itself comes from the shared heap - this task has no
+			cache yet so the call below can not recurse into it. */
+			pxCache = pvPortMalloc( sizeof( TaskCache_t ) );
+
+			if( pxCache != NULL )
+			{
+				memset( pxCache, 0, sizeof( TaskCache_t ) );
+				vTaskSetThreadLocalStoragePointer( NULL, configHEAP_TASK_CACHE_TLS_INDEX, pxCache );
+				xTaskCacheInUse = pdTRUE;
+				xReturn = pdTRUE;
+			}
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortTaskCacheDelete( void )
+	{
+	TaskCache_t *pxCache;
+
+		if( xTaskCacheInUse == pdTRUE )
+		{
+			pxCache = heapGET_TASK_CACHE();
+
+			if( pxCache != NULL )
+			{
+				( void ) prvTaskCacheFlush();
+
+				/* Detach the cache first so the free below goes to the shared
+				pools. */
+				vTaskSetThreadLocalStoragePointer( NULL, configHEAP_TASK_CACHE_TLS_INDEX, NULL );
+				vPortFree( pxCache );
+			}
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvTaskCacheFlush( void )
+	{
+	TaskCache_t *pxCache = NULL;
+	Block_t *pxTail;
+	BaseType_t xReturn = pdFALSE;
+
+		if( xTaskCacheInUse == pdTRUE )
+		{
+			pxCache = heapGET_TASK_CACHE();
+		}
+
+		if( pxCache != NULL )
+		{
+			for( size_t i = 0; i < xPoolCount; ++i )
+			{
+				heapMALLOC_SUSPEND();
+				heapPOOL_LOCK();
+				{
+					heapPOOL_COUNT_ALLOCATIONS( &( xPool[ i ] ), pxCache->xAllocations[ i ], 0 );
+					( void ) heapCOUNTER_SUB( xPool[ i ].xRoundingWaste, pxCache->xRequestedBytes[ i ] );
+				}
+				heapPOOL_UNLOCK();
+
+				/* The cached blocks were already freed by the task, so go back
+				as they are, in one chain. */
+				if( pxCache->pxFirstFree[ i ] != NULL )
+				{
+					for( pxTail = pxCache->pxFirstFree[ i ]; pxTail->pxNext != NULL; pxTail = pxTail->pxNext )
+					{
+						/* Nothing to do here, just find the end. */
+					}
+
+					prvPushChainToPool( pxCache->pxFirstFree[ i ], pxTail, pxCache->ucCount[ i ] );
+					xReturn = pdTRUE;
+				}
+				heapMALLOC_RESUME();
+
+				pxCache->pxFirstFree[ i ] = NULL;
+				pxCache->ucCount[ i ] = 0;
+				pxCache->xAllocations[ i ] = 0;
+				pxCache->xRequestedBytes[ i ] = 0;
+			}
+
+			pxCache->xCachedBytes = 0;
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void *prvTaskCacheAllocate( size_t xWantedSize )
+	{
+	TaskCache_t *pxCache;
+	Block_t *pxBlock = NULL;
+	size_t iter = heapMAXIMUM_POOL_NUM;
+	size_t xMoved = 0, xRoom;
+
+		if( ( xTaskCacheInUse == pdTRUE ) && ( xWantedSize > 0 ) )
+		{
+			iter = heapPOOL_CLASS_OF( xWantedSize );
+		}
+
+		if( ( iter < heapMAXIMUM_POOL_NUM ) && ( xPool[ iter ].xBlockSize <= configHEAP_TASK_CACHE_MAX_BYTES ) )
+		{
+			pxCache = heapGET_TASK_CACHE();
+
+			if( pxCache != NULL )
+			{
+				/* A refill takes no more than the byte limit leaves room for. */
+				xRoom = ( configHEAP_TASK_CACHE_MAX_BYTES - pxCache->xCachedBytes ) / xPool[ iter ].xBlockSize;
+				if( xRoom > configHEAP_TASK_CACHE_BATCH )
+				{
+					xRoom = configHEAP_TASK_CACHE_BATCH;
+				}
+
+				if( ( pxCache->pxFirstFree[ iter ] == NULL ) && ( xRoom > 0 ) )
+				{
+					/* Refill from the shared pool.  Only blocks already on its
+					free list are taken - carving is left to pvPortMalloc(). */
+					heapMALLOC_SUSPEND();
+					heapPOOL_LOCK();
+					{
+						while( xMoved < xRoom )
+						{
+							heapPOOL_POP( &( xPool[ iter ] ), pxBlock );
+							if( pxBlock == NULL )
+							{
+								break;
+							}
+
+							pxBlock->pxNext = pxCache->pxFirstFree[ iter ];
+							pxCache->pxFirstFree[ iter ] = pxBlock;
+							++xMoved;
+						}
+						heapPOOL_TAKE_BLOCKS( &( xPool[ iter ] ), xMoved );
+
+						/* Allocations served by the cache are counted when it
+						next goes back to the shared pool. */
+						heapPOOL_COUNT_ALLOCATIONS( &( xPool[ iter ] ), pxCache->xAllocations[ iter ], 0 );
+						( void ) heapCOUNTER_SUB( xPool[ iter ].xRoundingWaste, pxCache->xRequestedBytes[ iter ] );
+					}
+					heapPOOL_UNLOCK();
+					heapMALLOC_RESUME();
+
+					pxCache->ucCount[ iter ] = ( uint8_t ) xMoved;
+					pxCache->xCachedBytes += xMoved * xPool[ iter ].xBlockSize;
+					pxCache->xAllocations[ iter ] = 0;
+					pxCache->xRequestedBytes[ iter ] = 0;
+				}
+
+				pxBlock = pxCache->pxFirstFree[ iter ];
+				if( pxBlock != NULL )
+				{
+					pxCache->pxFirstFree[ iter ] = pxBlock->pxNext;
+					pxCache->ucCount[ iter ]--;
+					pxCache->xCachedBytes -= xPool[ iter ].xBlockSize;
+					pxCache->xAllocations[ iter ]++;
+
+					/* Any red zone counts as waste, as it does for blocks
+					from the shared pools. */
+					pxCache->xRequestedBytes[ iter ] += xWantedSize - portHEAP_GUARD_OVERHEAD;
+				}
+			}
+		}
+
+		return ( pxBlock != NULL ) ? heapBLOCK_TO_USER( pxBlock ) : NULL;
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvTaskCacheFree( Block_t *pxLink )
+	{
+	TaskCache_t *pxCache;
+	Block_t *pxFirst, *pxLast;
+	size_t iter;
+	BaseType_t xReturn = pdFALSE;
+
+		if( xTaskCacheInUse == pdTRUE )
+		{
+			pxCache = heapGET_TASK_CACHE();
+
+			iter = ( size_t ) ( heapPOOL_OF( pxLink ) - xPool );
+
+			/* A block that would take the cache over its byte limit goes to
+			the shared pool instead. */
+			if( ( pxCache != NULL ) && ( ( configHEAP_TASK_CACHE_MAX_BYTES - pxCache->xCachedBytes ) >= xPool[ iter ].xBlockSize ) )
+			{
+				pxLink->pxNext = pxCache->pxFirstFree[ iter ];
+				pxCache->pxFirstFree[ iter ] = pxLink;
+				pxCache->ucCount[ iter ]++;
+				pxCache->xCachedBytes += xPool[ iter ].xBlockSize;
+
+				if( pxCache->ucCount[ iter ] > configHEAP_TASK_CACHE_DEPTH )
+				{
+					/* Hand a batch back so other tasks can use it. */
+					pxFirst = pxCache->pxFirstFree[ iter ];
+					pxLast = pxFirst;
+					for( size_t i = 1; i < configHEAP_TASK_CACHE_BATCH; ++i )
+					{
+						pxLast = pxLast->pxNext;
+					}
+					pxCache->pxFirstFree[ iter ] = pxLast->pxNext;
+
+					heapMALLOC_SUSPEND();
+					heapPOOL_LOCK();
+					{
+						heapPOOL_PUSH( &( xPool[ iter ] ), pxFirst, pxLast );
+						heapPOOL_RETURN_BLOCKS( &( xPool[ iter ] ), configHEAP_TASK_CACHE_BATCH );
+					}
+					heapPOOL_UNLOCK();
+					heapMALLOC_RESUME();
+
+					pxCache->ucCount[ iter ] -= configHEAP_TASK_CACHE_BATCH;
+					pxCache->xCachedBytes -= configHEAP_TASK_CACHE_BATCH * xPool[ iter ].xBlockSize;
+				}
+
+				xReturn = pdTRUE;
+			}
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* configHEAP_USE_TASK_CACHE */
+
+#if( configHEAP_USE_OBJECT_POOLS == 1 )
+
+	ObjectPoolHandle_t xPortObjectPoolCreate( size_t xObjectSize, size_t xCapacity )
+	{
+	ObjectPool_t *pxObjectPool = NULL;
+	size_t xStride;
+	Block_t *pxObject;
+
+		if( ( xObjectSize > 0 ) && ( xCapacity > 0 ) && ( xObjectSize <= ( ( size_t ) -1 ) - heapOBJECT_MINIMUM_STRIDE ) )
+		{
+			xStride = ( xObjectSize + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+			if( xStride < heapOBJECT_MINIMUM_STRIDE )
+			{
+				xStride = heapOBJECT_MINIMUM_STRIDE;
+			}
+
+			if( xCapacity <= ( ( ( size_t ) -1 ) - heapOBJECT_POOL_HEADER_SIZE ) / xStride )
+			{
+				pxObjectPool = pvPortMalloc( heapOBJECT_POOL_HEADER_SIZE + ( xCapacity * xStride ) );
+			}
+		}
+
+		if( pxObjectPool != NULL )
+		{
+			memset( &( pxObjectPool->xObjects ), 0, sizeof( Pool_t ) );
+			pxObjectPool->xObjects.xBlockSize = xStride;
+			pxObjectPool->xObjects.xBlocksCarved = xCapacity;
+			pxObjectPool->pucObjects = ( uint8_t * ) pxObjectPool + heapOBJECT_POOL_HEADER_SIZE;
+
+			/* Chain the objects in address order.  Nothing else can see the
+			pool yet. */
+			pxObject = ( void * ) pxObjectPool->pucObjects;
+			for( size_t i = 1; i < xCapacity; ++i )
+			{
+				pxObject->pxNext = ( void * ) ( ( uint8_t * ) pxObject + xStride );
+				pxObject = pxObject->pxNext;
+			}
+
+			heapPOOL_PUSH( &( pxObjectPool->xObjects ), ( Block_t * ) ( void * ) pxObjectPool->pucObjects, pxObject );
+		}
+
+		return pxObjectPool;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortObjectPoolDelete( ObjectPoolHandle_t xObjectPool )
+	{
+		if( xObjectPool != NULL )
+		{
+			/* The objects go with the pool. */
+			configASSERT( xObjectPool->xObjects.xBlocksInUse == 0 );
+			vPortFree( xObjectPool );
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	void *pvPortObjectPoolAlloc( ObjectPoolHandle_t xObjectPool )
+	{
+	Block_t *pxObject;
+
+		configASSERT( xObjectPool != NULL );
+
+		heapOBJECT_SUSPEND();
+		heapOBJECT_LOCK();
+		{
+			heapPOOL_POP( &( xObjectPool->xObjects ), pxObject );
+			if( pxObject != NULL )
+			{
+				const size_t xNowInUse = heapCOUNTER_ADD( xObjectPool->xObjects.xBlocksInUse, 1 );
+				heapRAISE_WATERMARK( xObjectPool->xObjects.xMaxBlocksInUse, xNowInUse );
+			}
+		}
+		heapOBJECT_UNLOCK();
+		heapOBJECT_RESUME();
+
+		return pxObject;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortObjectPoolFree( ObjectPoolHandle_t xObjectPool, void *pv )
+	{
+	Block_t *pxObject = pv;
+
+		if( pxObject != NULL )
+		{
+			configASSERT( xObjectPool != NULL );
+
+			/* pv must be one of this pool's objects. */
+			configASSERT( ( ( uint8_t * ) pv >= xObjectPool->pucObjects ) &&
+						  ( ( size_t ) ( ( uint8_t * ) pv - xObjectPool->pucObjects ) < ( xObjectPool->xObjects.xBlocksCarved * xObjectPool->xObjects.xBlockSize ) ) &&
+						  ( ( ( size_t ) ( ( uint8_t * ) pv - xObjectPool->pucObjects ) % xObjectPool->xObjects.xBlockSize ) == 0 ) );
+
+			heapOBJECT_SUSPEND();
+			heapOBJECT_LOCK();
+			{
+				heapPOOL_PUSH( &( xObjectPool->xObjects ), pxObject, pxObject );
+				( void ) heapCOUNTER_SUB( xObjectPool->xObjects.xBlocksInUse, 1 );
+			}
+			heapOBJECT_UNLOCK();
+			heapOBJECT_RESUME();
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	size_t xPortObjectPoolGetFreeCount( ObjectPoolHandle_t xObjectPool )
+	{
+		configASSERT( xObjectPool != NULL );
+
+		return xObjectPool->xObjects.xBlocksCarved - xObjectPool->xObjects.xBlocksInUse;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* configHEAP_USE_OBJECT_POOLS */
+
+#if( configHEAP_USE_RECLAIM == 1 )
+
+	BaseType_t xPortPoolAddReclaimCallback( size_t xBlockSize, size_t xWatermark, HeapReclaimCallback_t pxCallback, void *pvParameter )
+	{
+	size_t iter = heapMAXIMUM_POOL_NUM;
+
+		/* The pool is the one pvPortMalloc() would pick for the same size. */
+		heapGUARD_GROW( xBlockSize );
+		prvEnsureInitialised();
+
+		if( xBlockSize > 0 )
+		{
+			iter = heapPOOL_CLASS_OF( xBlockSize );
+		}
+
+		return ( iter < heapMAXIMUM_POOL_NUM ) ? xPortHeapReclaimAdd( iter, xWatermark, pxCallback, pvParameter ) : pdFALSE;
+	}
+	/*-----------------------------------------------------------*/
+
+	static size_t prvPoolBlocksAvailable( size_t xPoolIndex )
+	{
+	size_t xUncarved = 0;
+
+		/* Pools carve from any region, once their preferred one is full.  The
+		bump pointers are read without the lock, which is close enough for a
+		watermark. */
+		for( size_t x = 0; x < xRegionCount; ++x )
+		{
+			xUncarved += heapUNCARVED_BYTES( &( xRegion[ x ] ) );
+		}
+
+		#if( configHEAP_USE_SPANS == 1 )
+		{
+			xUncarved += xSpanReserveBytes;
+		}
+		#endif
+
+		return ( xPool[ xPoolIndex ].xBlocksCarved - xPool[ xPoolIndex ].xBlocksInUse ) + ( xUncarved / xPool[ xPoolIndex ].xBlockSize );
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* configHEAP_USE_RECLAIM */
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( HeapStats_t *pxHeapStats, HeapPoolStats_t *pxPoolStats, size_t xPoolStatsLength )
+{
+LargeBlock_t *pxLarge;
+size_t xPools;
+#if( configHEAP_USE_SPANS == 1 )
+	size_t xPerSpan;
+#endif
+
+	prvEnsureInitialised();
+
+	/* The large block list is walked with the scheduler suspended, just as
+	pvPortMalloc() would.  The counters are then copied in one short
+	critical section so the snapshot is consistent. */
+	vTaskSuspendAll();
+	{
+		pxHeapStats->xNumberOfFreeLargeBlocks = 0;
+		pxHeapStats->xSizeOfLargestFreeLargeBlock = 0;
+		pxHeapStats->xFreeLargeBlockBytes = 0;
+
+		for( pxLarge = xLargeStart.pxNextFreeBlock; pxLarge != NULL; pxLarge = pxLarge->pxNextFreeBlock )
+		{
+			pxHeapStats->xNumberOfFreeLargeBlocks++;
+			pxHeapStats->xFreeLargeBlockBytes += pxLarge->xBlockSize;
+
+			if( pxLarge->xBlockSize > pxHeapStats->xSizeOfLargestFreeLargeBlock )
+			{
+				pxHeapStats->xSizeOfLargestFreeLargeBlock = pxLarge->xBlockSize;
+			}
+		}
+
+		xPools = ( xPoolCount < xPoolStatsLength ) ? xPoolCount : xPoolStatsLength;
+
+		taskENTER_CRITICAL();
+		{
+			pxHeapStats->xAvailableHeapSpaceInBytes = xFreeBytesRemaining;
+			pxHeapStats->xMinimumEverFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+			pxHeapStats->xUnallocatedBytes = 0;
+			for( size_t i = 0; i < xRegionCount; ++i )
+			{
+				pxHeapStats->xUnallocatedBytes += heapUNCARVED_BYTES( &( xRegion[ i ] ) );
+			}
+			#if( configHEAP_USE_SPANS == 1 )
+			{
+				pxHeapStats->xSpanReserveBytes = xSpanReserveBytes;
+			}
+			#else
+			{
+				pxHeapStats->xSpanReserveBytes = 0;
+			}
+			#endif
+			pxHeapStats->xLargeBlocksInUse = xLargeBlocksInUse;
+			pxHeapStats->xNumberOfPools = xPoolCount;
+
+			for( size_t i = 0; ( pxPoolStats != NULL ) && ( i < xPools ); ++i )
+			{
+				pxPoolStats[ i ].xBlockSize = xPool[ i ].xBlockSize;
+				pxPoolStats[ i ].xBlocksInUse = xPool[ i ].xBlocksInUse;
+				pxPoolStats[ i ].xFreeBlocks = xPool[ i ].xBlocksCarved - xPool[ i ].xBlocksInUse;
+				pxPoolStats[ i ].xMaxBlocksInUse = xPool[ i ].xMaxBlocksInUse;
+				pxPoolStats[ i ].xAllocations = xPool[ i ].xAllocations;
+				pxPoolStats[ i ].xRoundingWaste = xPool[ i ].xRoundingWaste;
+				#if( configHEAP_USE_SPANS == 1 )
+				{
+					/* The tail of each span that no block fits in. */
+					xPerSpan = xPool[ i ].xSpanSize / heapPOOL_STRIDE( xPool[ i ].xBlockSize );
+					pxPoolStats[ i ].xOverheadBytes = ( xPool[ i ].xBlocksCarved / xPerSpan ) * ( xPool[ i ].xSpanSize % heapPOOL_STRIDE( xPool[ i ].xBlockSize ) );
+				}
+				#else
+				{
+					/* The header and alignment padding of each block. */
+					pxPoolStats[ i ].xOverheadBytes = xPool[ i ].xBlocksCarved * ( heapPOOL_STRIDE( xPool[ i ].xBlockSize ) - xPool[ i ].xBlockSize );
+				}
+				#endif
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+#if( configHEAP_USE_REGIONS == 1 )
+
+	void vPortDefineHeapRegions( const HeapRegion_t * const pxHeapRegions )
+	{
+		vPortDefineHeapRegionsCaps( pxHeapRegions, NULL );
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortDefineHeapRegionsCaps( const HeapRegion_t * const pxHeapRegions, const uint32_t *pulCapsList )
+	{
+	const HeapRegion_t *pxHeapRegion;
+	portPOINTER_SIZE_TYPE xAddress, xEndAddress;
+
+		/* The regions can only be given once, before the first allocation. */
+		configASSERT( xHeapHasBeenInitialised == pdFALSE );
+
+		vTaskSuspendAll();
+		{
+			if( xHeapHasBeenInitialised == pdFALSE )
+			{
+				for( pxHeapRegion = pxHeapRegions; pxHeapRegion->xSizeInBytes > 0; pxHeapRegion++ )
+				{
+					/* Every region beyond heapMAXIMUM_REGION_NUM is lost. */
+					configASSERT( xRegionCount < heapMAXIMUM_REGION_NUM );
+
+					if( xRegionCount == heapMAXIMUM_REGION_NUM )
+					{
+						break;
+					}
+
+					/* Ensure the region starts and ends on an aligned
+					boundary. */
+					xAddress = ( portPOINTER_SIZE_TYPE ) pxHeapRegion->pucStartAddress;
+					xEndAddress = ( xAddress + pxHeapRegion->xSizeInBytes ) & ~( ( portPOINTER_SIZE_TYPE ) portBYTE_ALIGNMENT_MASK );
+					xAddress = ( xAddress + portBYTE_ALIGNMENT_MASK ) & ~( ( portPOINTER_SIZE_TYPE ) portBYTE_ALIGNMENT_MASK );
+
+					/* A region too small to hold anything once aligned is
+					still given its index, so that the indices passed to
+					vPortPoolInitRegions() match the array. */
+					if( xEndAddress < xAddress )
+					{
+						xEndAddress = xAddress;
+					}
+
+					/* Regions must be in address order, so that offsets from
+					the first one fit in a heap snapshot. */
+					configASSERT( ( xRegionCount == 0 ) || ( ( uint8_t * ) xAddress >= xRegion[ xRegionCount - 1 ].pucHeapEnd ) );
+
+					xRegion[ xRegionCount ].pucHeapStart = ( uint8_t * ) xAddress;
+					xRegion[ xRegionCount ].pxFreeHeap = ( void * ) xAddress;
+					xRegion[ xRegionCount ].pucHeapEnd = ( uint8_t * ) xEndAddress;
+					xRegion[ xRegionCount ].xRegionSize = ( size_t ) ( xEndAddress - xAddress );
+					xRegion[ xRegionCount ].ulCaps = ( pulCapsList != NULL ) ? pulCapsList[ xRegionCount ] : 0;
+					xTotalHeapSize += ( size_t ) ( xEndAddress - xAddress );
+					xRegionCount++;
+				}
+
+				/* At least one region must have been given. */
+				configASSERT( xRegionCount > 0 );
+
+				xFreeBytesRemaining = xTotalHeapSize;
+				xMinimumEverFreeBytesRemaining = xTotalHeapSize;
+				xHeapHasBeenInitialised = pdTRUE;
+			}
+		}
+		( void ) xTaskResumeAll();
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvHeapInit( void )
+	{
+		/* vPortDefineHeapRegions() has not been called, so there is no heap -
+		every allocation will fail. */
+		configASSERT( xRegionCount > 0 );
+	}
+	/*-----------------------------------------------------------*/
+
+	static uint32_t prvRegionMaskOf( const void *pv )
+	{
+	uint32_t ulReturn = 0;
+
+		for( size_t i = 0; i < xRegionCount; ++i )
+		{
+			if( ( ( uint8_t * ) pv >= xRegion[ i ].pucHeapStart ) && ( ( uint8_t * ) pv < xRegion[ i ].pucHeapEnd ) )
+			{
+				ulReturn = heapREGION_BIT( i );
+				break;
+			}
+		}
+
+		return ulReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	void *pvPortMallocCaps( size_t xWantedSize, uint32_t ulCaps )
+	{
+	void *pvReturn = NULL;
+	Block_t *pxBlock = NULL;
+	size_t iter = heapMAXIMUM_POOL_NUM;
+	uint32_t ulRegionMask = 0;
+	const size_t xRequestedSize = xWantedSize;
+
+		if( ulCaps == 0 )
+		{
+			/* Any memory will do. */
+			return pvPortMalloc( xWantedSize );
+		}
+
+		heapGUARD_GROW( xWantedSize );
+		prvEnsureInitialised();
+
+		for( size_t i = 0; i < xRegionCount; ++i )
+		{
+			if( ( xRegion[ i ].ulCaps & ulCaps ) == ulCaps )
+			{
+				ulRegionMask |= heapREGION_BIT( i );
+			}
+		}
+
+		if( ( ulRegionMask != 0 ) && ( xWantedSize > 0 ) && ( xWantedSize <= xTotalHeapSize ) )
+		{
+			iter = heapPOOL_CLASS_OF( xWantedSize );
+
+			heapMALLOC_SUSPEND();
+			{
+				if( iter < heapMAXIMUM_POOL_NUM )
+				{
+					/* A pool's free list mixes blocks from every region, so
+					only its head is looked at.  Otherwise a fresh block is
+					carved from a region that has the caps - the block header
+					still names the pool, so it is freed as any other. */
+					heapPOOL_LOCK();
+					{
+						pxBlock = heapPOOL_FIRST( &( xPool[ iter ] ) );
+						if( ( pxBlock != NULL ) && heapIN_REGIONS( pxBlock, ulRegionMask ) )
+						{
+							/* The lock is held, so this pops the block just
+							looked at. */
+							heapPOOL_POP( &( xPool[ iter ] ), pxBlock );
+							heapPOOL_TAKE_BLOCKS( &( xPool[ iter ] ), 1 );
+							heapPOOL_COUNT_ALLOCATIONS( &( xPool[ iter ] ), 1, xRequestedSize );
+						}
+						else
+						{
+							pxBlock = NULL;
+						}
+					}
+					heapPOOL_UNLOCK();
+
+					if( pxBlock == NULL )
+					{
+						pxBlock = prvCarve( xPool[ iter ].xRegion, ulRegionMask, heapPOOL_STRIDE( xPool[ iter ].xBlockSize ) );
+
+						if( pxBlock != NULL )
+						{
+							heapSET_POOL( pxBlock, &( xPool[ iter ] ) );
+
+							heapPOOL_LOCK();
+							( void ) heapCOUNTER_ADD( xPool[ iter ].xBlocksCarved, 1 );
+							heapPOOL_TAKE_BLOCKS( &( xPool[ iter ] ), 1 );
+							heapPOOL_COUNT_ALLOCATIONS( &( xPool[ iter ] ), 1, xRequestedSize );
+							heapPOOL_UNLOCK();
+						}
+					}
+
+					if( pxBlock != NULL )
+					{
+						pvReturn = heapBLOCK_TO_USER( pxBlock );
+						portHEAP_TAG_RECORD( pvReturn, xPool[ iter ].xBlockSize );
+					}
+				}
+
+				if( pvReturn == NULL )
+				{
+					/* Too big for a pool, or the regions with the caps have
+					no room left for a fresh pool block.  A free large block
+					in one of them might still do. */
+					xWantedSize += heapSTRUCT_SIZE;
+					if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0 )
+					{
+						xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+					}
+
+					heapLARGE_SUSPEND();
+					pvReturn = prvAllocateLargeBlock( xWantedSize, ulRegionMask );
+					heapLARGE_RESUME();
+				}
+			}
+			heapMALLOC_RESUME();
+		}
+
+		heapGUARD_ARM( pvReturn, xRequestedSize );
+		portHEAP_TRACE_MALLOC( pvReturn, xRequestedSize );
+
+		#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+		{
+			if( pvReturn == NULL )
+			{
+				extern void vApplicationMallocFailedHook( void );
+				vApplicationMallocFailedHook();
+			}
+		}
+		#endif
+
+		return pvReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+#else
+
+	static void prvHeapInit( void )
+	{
+	uint8_t *pucAlignedHeap;
+
+		/* Ensure the heap starts on a correctly aligned boundary. */
+		pucAlignedHeap = ( uint8_t * ) ( ( ( portPOINTER_SIZE_TYPE ) &ucHeap[ portBYTE_ALIGNMENT ] ) & ( ~( ( portPOINTER_SIZE_TYPE ) portBYTE_ALIGNMENT_MASK ) ) );
+
+		/* To start with there is a single region that is sized to take up the
+		entire heap space. */
+		xRegion[ 0 ].pucHeapStart = pucAlignedHeap;
+		xRegion[ 0 ].pxFreeHeap = ( void * ) pucAlignedHeap;
+		xRegion[ 0 ].pucHeapEnd = pucAlignedHeap + configADJUSTED_HEAP_SIZE;
+		xRegion[ 0 ].xRegionSize = configADJUSTED_HEAP_SIZE;
+		xRegionCount = 1;
+
+		xTotalHeapSize = configADJUSTED_HEAP_SIZE;
+		xFreeBytesRemaining = configADJUSTED_HEAP_SIZE;
+		xMinimumEverFreeBytesRemaining = configADJUSTED_HEAP_SIZE;
+	}
+	/*-----------------------------------------------------------*/
+
+	void *pvPortMallocCaps( size_t xWantedSize, uint32_t ulCaps )
+	{
+	void *pvReturn = NULL;
+
+		/* There is only ucHeap, so either it has the caps or nothing does. */
+		if( ( ulCaps & ~( ( uint32_t ) configHEAP_CAPS ) ) == 0 )
+		{
+			pvReturn = pvPortMalloc( xWantedSize );
+		}
+		else
+		{
+			#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+			{
+				extern void vApplicationMallocFailedHook( void );
+				vApplicationMallocFailedHook();
+			}
+			#endif
+		}
+
+		return pvReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* configHEAP_USE_REGIONS */
+
+#if( configHEAP_USE_SPANS == 0 )
+
+	static void *prvCarve( size_t xPreferred, uint32_t ulRegionMask, size_t xSize )
+	{
+	void *pvReturn = NULL;
+	Region_t *pxArea;
+	size_t x;
+
+		if( xPreferred >= xRegionCount )
+		{
+			xPreferred = 0;
+		}
+
+		heapBUMP_LOCK();
+		{
+			for( size_t k = 0; ( k < xRegionCount ) && ( pvReturn == NULL ); ++k )
+			{
+				x = heapREGION_ORDER( xPreferred, k );
+				pxArea = &( xRegion[ x ] );
+
+				if( ( ( ulRegionMask & heapREGION_BIT( x ) ) != 0 ) && heapCAN_CARVE( pxArea, xSize ) )
+				{
+					/* The void cast is used to prevent byte alignment warnings
+					from the compiler. */
+					pvReturn = pxArea->pxFreeHeap;
+					pxArea->pxFreeHeap = ( void * ) ( ( uint8_t * ) pxArea->pxFreeHeap + xSize );
+				}
+			}
+		}
+		heapBUMP_UNLOCK();
+
+		return pvReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* configHEAP_USE_SPANS */
+
+static void prvEnsureInitialised( void )
+{
+	if( xPoolHasBeenInitialised == pdFALSE )
+	{
+		vTaskSuspendAll();
+		{
+			if( xHeapHasBeenInitialised == pdFALSE )
+			{
+				prvHeapInit();
+				xHeapHasBeenInitialised = pdTRUE;
+			}
+
+			/* Fall back to the default pool sizes if the application did not
+			call vPortPoolInit(). */
+			if( xPoolHasBeenInitialised == pdFALSE )
+			{
+				prvPoolInit( xSizeList, NULL, heapDEFAULT_POOL_NUM );
+			}
+		}
+		( void ) xTaskResumeAll();
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void *prvAllocateLargeBlock( size_t xWantedSize, uint32_t ulRegionMask )
+{
+LargeBlock_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
+void *pvReturn = NULL;
+
+	/* Traverse the list from the start (lowest address) block until one of
+	adequate size, in one of the wanted regions, is found. */
+	pxPreviousBlock = &xLargeStart;
+	pxBlock = xLargeStart.pxNextFreeBlock;
+	while( ( pxBlock != NULL ) && ( ( pxBlock->xBlockSize < xWantedSize ) || !heapIN_REGIONS( pxBlock, ulRegionMask ) ) )
+	{
+		pxPreviousBlock = pxBlock;
+		pxBlock = pxBlock->pxNextFreeBlock;
+	}
+
+	if( pxBlock != NULL )
+	{
+		/* If the block is larger than required it can be split into two.  The
+		remainder takes the place of the original block in the list, so the
+		address order is kept without walking the list again. */
+		if( ( pxBlock->xBlockSize - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
+		{
+			pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+			pxNewBlockLink->xBlockSize = pxBlock->xBlockSize - xWantedSize;
+			pxNewBlockLink->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+			pxPreviousBlock->pxNextFreeBlock = pxNewBlockLink;
+			pxBlock->xBlockSize = xWantedSize;
+		}
+		else
+		{
+			pxPreviousBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+		}
+	}
+	else
+	{
+		/* Nothing on the list is big enough, so take fresh space from the
+		unallocated heap. */
+		pxBlock = prvCarveLargeBlock( xWantedSize, ulRegionMask );
+	}
+
+	if( pxBlock != NULL )
+	{
+		pvReturn = prvClaimLargeBlock( pxBlock );
+	}
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvAllocateAlignedLargeBlock( size_t xWantedSize, size_t xAlignment )
+{
+LargeBlock_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
+size_t uxAddress, xLead = 0;
+BaseType_t xCarved = pdFALSE;
+
+	for( ;; )
+	{
+		/* Find the first block that still holds xWantedSize bytes once the
+		space in front of the first aligned address in it is split off.  That
+		space must be either nothing or big enough to be a free block itself. */
+		pxPreviousBlock = &xLargeStart;
+		for( pxBlock = xLargeStart.pxNextFreeBlock; pxBlock != NULL; pxBlock = pxBlock->pxNextFreeBlock )
+		{
+			uxAddress = ( ( size_t ) pxBlock ) + heapSTRUCT_SIZE;
+			uxAddress = ( uxAddress + ( xAlignment - 1 ) ) & ~( xAlignment - 1 );
+			xLead = uxAddress - heapSTRUCT_SIZE - ( size_t ) pxBlock;
+
+			if( ( xLead != 0 ) && ( xLead < heapMINIMUM_BLOCK_SIZE ) )
+			{
+				xLead += ( ( heapMINIMUM_BLOCK_SIZE - xLead ) + ( xAlignment - 1 ) ) & ~( xAlignment - 1 );
+			}
+
+			if( ( pxBlock->xBlockSize > xLead ) && ( ( pxBlock->xBlockSize - xLead ) >= xWantedSize ) )
+			{
+				break;
+			}
+
+			pxPreviousBlock = pxBlock;
+		}
+
+		if( ( pxBlock != NULL ) || ( xCarved == pdTRUE ) )
+		{
+			break;
+		}
+
+		/* Carve a block big enough to hold the request however it lands, and
+		free it so the search above finds it.  It was counted as free while
+		it was unallocated, so xFreeBytesRemaining does not change.  It
+		borders the unallocated heap, so it is linked without giving it
+		straight back.  What is not used goes back to the free list below. */
+		pxBlock = prvCarveLargeBlock( xWantedSize + xAlignment + heapMINIMUM_BLOCK_SIZE, heapALL_REGIONS );
+		if( pxBlock == NULL )
+		{
+			return NULL;
+		}
+
+		( void ) prvLinkBlockIntoFreeList( pxBlock );
+		xCarved = pdTRUE;
+	}
+
+	if( pxBlock == NULL )
+	{
+		return NULL;
+	}
+
+	if( xLead != 0 )
+	{
+		/* The space in front stays where the block was in the list, so the
+		address order is kept.  When spans are used large blocks are carved
+		downwards, so for a carved block it is this space that may border the
+		unallocated heap, and it is given back once the rest is claimed. */
+		pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xLead );
+		pxNewBlockLink->xBlockSize = pxBlock->xBlockSize - xLead;
+		pxBlock->xBlockSize = xLead;
+		pxPreviousBlock = pxBlock;
+		pxBlock = pxNewBlockLink;
+	}
+	else
+	{
+		pxPreviousBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+	}
+
+	/* The tail, if it is worth keeping, follows in the list.  For a carved
+	block it borders the unallocated heap, unless spans are used, so give it
+	back. */
+	if( ( pxBlock->xBlockSize - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
+	{
+		pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+		pxNewBlockLink->xBlockSize = pxBlock->xBlockSize - xWantedSize;
+		pxNewBlockLink->pxNextFreeBlock = pxPreviousBlock->pxNextFreeBlock;
+		pxPreviousBlock->pxNextFreeBlock = pxNewBlockLink;
+		pxBlock->xBlockSize = xWantedSize;
+
+		if( xCarved == pdTRUE )
+		{
+			prvReleaseTrailingBlock( pxNewBlockLink );
+		}
+	}
+
+	if( ( xCarved == pdTRUE ) && ( xLead != 0 ) )
+	{
+		prvReleaseTrailingBlock( pxPreviousBlock );
+	}
+
+	return prvClaimLargeBlock( pxBlock );
+}
+/*-----------------------------------------------------------*/
+
+static LargeBlock_t *prvCarveLargeBlock( size_t xWantedSize, uint32_t ulRegionMask )
+{
+LargeBlock_t *pxBlock = NULL;
+
+	#if( configHEAP_USE_SPANS == 1 )
+	{
+		/* There is a single region, so the mask is always met. */
+		( void ) ulRegionMask;
+
+		heapBUMP_LOCK();
+		if( heapCAN_CARVE( &( xRegion[ 0 ] ), xWantedSize ) )
+		{
+			/* Keep the pool spans below and the large blocks above. */
+			xRegion[ 0 ].pucHeapEnd -= xWantedSize;
+			pxBlock = ( void * ) xRegion[ 0 ].pucHeapEnd;
+		}
+		heapBUMP_UNLOCK();
+	}
+	#else
+	{
+		pxBlock = prvCarve( configHEAP_LARGE_BLOCK_REGION, ulRegionMask, xWantedSize );
+	}
+	#endif
+
+	if( pxBlock != NULL )
+	{
+		pxBlock->xBlockSize = xWantedSize;
+	}
+
+	return pxBlock;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvClaimLargeBlock( LargeBlock_t *pxBlock )
+{
+	portHEAP_TAG_RECORD( ( ( uint8_t * ) pxBlock ) + heapSTRUCT_SIZE, pxBlock->xBlockSize );
+
+	heapPOOL_LOCK();
+	{
+		heapTAKE_FREE_BYTES( pxBlock->xBlockSize );
+		( void ) heapCOUNTER_ADD( xLargeBlocksInUse, 1 );
+	}
+	heapPOOL_UNLOCK();
+
+	/* The block is being returned - mark it as a large block. */
+	pxBlock->xBlockSize |= heapLARGE_BLOCK_BIT;
+	pxBlock->pxNextFreeBlock = NULL;
+
+	return ( void * ) ( ( ( uint8_t * ) pxBlock ) + heapSTRUCT_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvResizeLargeBlock( LargeBlock_t *pxBlock, size_t xWantedSize )
+{
+LargeBlock_t *pxIterator, *pxNext, *pxNewBlockLink;
+size_t xBlockSize = pxBlock->xBlockSize & ~heapLARGE_BLOCK_BIT;
+
+	if( xWantedSize > xBlockSize )
+	{
+		/* Pool blocks and large blocks are mixed in the carved heap, so the
+		only way to know the block that follows is free is to find it on the
+		list. */
+		pxNext = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xBlockSize );
+		for( pxIterator = &xLargeStart; ( pxIterator->pxNextFreeBlock != NULL ) && ( pxIterator->pxNextFreeBlock < pxNext ); pxIterator = pxIterator->pxNextFreeBlock )
+		{
+			/* Nothing to do here, just iterate to the right position. */
+		}
+
+		if( ( pxIterator->pxNextFreeBlock != pxNext ) || ( ( xBlockSize + pxNext->xBlockSize ) < xWantedSize ) )
+		{
+			return pdFALSE;
+		}
+
+		pxIterator->pxNextFreeBlock = pxNext->pxNextFreeBlock;
+		xBlockSize += pxNext->xBlockSize;
+
+		heapPOOL_LOCK();
+		{
+			heapTAKE_FREE_BYTES( pxNext->xBlockSize );
+		}
+		heapPOOL_UNLOCK();
+	}
+
+	/* Give any tail that is worth keeping back to the free list, where it is
+	merged with the block that follows it if that one is free. */
+	if( ( xBlockSize - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
+	{
+		pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+		pxNewBlockLink->xBlockSize = xBlockSize - xWantedSize;
+		xBlockSize = xWantedSize;
+
+		heapPOOL_LOCK();
+		( void ) heapCOUNTER_ADD( xFreeBytesRemaining, pxNewBlockLink->xBlockSize );
+		heapPOOL_UNLOCK();
+
+		prvInsertBlockIntoFreeList( pxNewBlockLink );
+	}
+
+	pxBlock->xBlockSize = xBlockSize | heapLARGE_BLOCK_BIT;
+	portHEAP_TAG_RESIZE( ( ( uint8_t * ) pxBlock ) + heapSTRUCT_SIZE, xBlockSize );
+
+	return pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+static void prvFreeLargeBlock( LargeBlock_t *pxBlock )
+{
+	portHEAP_TAG_FORGET( ( ( uint8_t * ) pxBlock ) + heapSTRUCT_SIZE );
+
+	/* Large blocks go back to the address ordered list, where they are merged
+	with any free neighbours. */
+	pxBlock->xBlockSize &= ~heapLARGE_BLOCK_BIT;
+
+	heapPOOL_LOCK();
+	{
+		( void ) heapCOUNTER_ADD( xFreeBytesRemaining, pxBlock->xBlockSize );
+		( void ) heapCOUNTER_SUB( xLargeBlocksInUse, 1 );
+	}
+	heapPOOL_UNLOCK();
+
+	heapLARGE_SUSPEND();
+	heapLARGE_TIMING_START( portHEAP_TIMING_FREE );
+	prvInsertBlockIntoFreeList( pxBlock );
+	heapLARGE_TIMING_STOP( portHEAP_TIMING_FREE );
+	heapLARGE_RESUME();
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertBlockIntoFreeList( LargeBlock_t *pxBlockToInsert )
+{
+	portHEAP_TIMING_START( portHEAP_TIMING_INSERT );
+	prvReleaseTrailingBlock( prvLinkBlockIntoFreeList( pxBlockToInsert ) );
+	portHEAP_TIMING_STOP( portHEAP_TIMING_INSERT );
+}
+/*-----------------------------------------------------------*/
+
+static LargeBlock_t *prvLinkBlockIntoFreeList( LargeBlock_t *pxBlockToInsert )
+{
+LargeBlock_t *pxIterator;
+uint8_t *puc;
+
+	/* Iterate through the list until a block is found that has a higher address
+	than the block being inserted. */
+	for( pxIterator = &xLargeStart; ( pxIterator->pxNextFreeBlock != NULL ) && ( pxIterator->pxNextFreeBlock < pxBlockToInsert ); pxIterator = pxIterator->pxNextFreeBlock )
+	{
+		/* Nothing to do here, just iterate to the right position. */
+	}
+
+	/* Do the block being inserted, and the block it is being inserted after
+	make a contiguous block of memory? */
+	puc = ( uint8_t * ) pxIterator;
+	if( ( pxIterator != &xLargeStart ) && ( ( puc + pxIterator->xBlockSize ) == ( uint8_t * ) pxBlockToInsert ) )
+	{
+		pxIterator->xBlockSize += pxBlockToInsert->xBlockSize;
+		pxBlockToInsert = pxIterator;
+	}
+
+	/* Do the block being inserted, and the block it is being inserted before
+	make a contiguous block of memory? */
+	puc = ( uint8_t * ) pxBlockToInsert;
+	if( ( pxIterator->pxNextFreeBlock != NULL ) && ( ( puc + pxBlockToInsert->xBlockSize ) == ( uint8_t * ) pxIterator->pxNextFreeBlock ) )
+	{
+		/* Form one big block from the two blocks. */
+		pxBlockToInsert->xBlockSize += pxIterator->pxNextFreeBlock->xBlockSize;
+		pxBlockToInsert->pxNextFreeBlock = pxIterator->pxNextFreeBlock->pxNextFreeBlock;
+	}
+	else
+	{
+		pxBlockToInsert->pxNextFreeBlock = pxIterator->pxNextFreeBlock;
+	}
+
+	/* If the block being inserted plugged a gap, so was merged with the block
+	before and the block after, then it's pxNextFreeBlock pointer will have
+	already been set, and should not be set here as that would make it point
+	to itself. */
+	if( pxIterator != pxBlockToInsert )
+	{
+		pxIterator->pxNextFreeBlock = pxBlockToInsert;
+	}
+
+	return pxBlockToInsert;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReleaseTrailingBlock( LargeBlock_t *pxBlock )
+{
+LargeBlock_t *pxPrevious = &xLargeStart;
+BaseType_t xReleased = pdFALSE;
+
+	#if( configHEAP_USE_SPANS == 1 )
+	{
+		/* Large blocks are carved downwards, so only the lowest free block can
+		border the unallocated heap, and it is first on the list. */
+		heapBUMP_LOCK();
+		{
+			if( ( uint8_t * ) pxBlock == xRegion[ 0 ].pucHeapEnd )
+			{
+				xRegion[ 0 ].pucHeapEnd += pxBlock->xBlockSize;
+				configASSERT( xRegion[ 0 ].pucHeapEnd <= ( xRegion[ 0 ].pucHeapStart + xRegion[ 0 ].xRegionSize ) );
+				xReleased = pdTRUE;
+			}
+		}
+		heapBUMP_UNLOCK();
+	}
+	#else
+	{
+	uint8_t *pucBlockEnd = ( uint8_t * ) pxBlock + pxBlock->xBlockSize;
+
+		/* Find the block before pxBlock first, as the list is protected by
+		the caller while the bump pointers also move under pool carves. */
+		for( size_t x = 0; x < xRegionCount; ++x )
+		{
+			if( pucBlockEnd == ( uint8_t * ) xRegion[ x ].pxFreeHeap )
+			{
+				while( pxPrevious->pxNextFreeBlock != pxBlock )
+				{
+					pxPrevious = pxPrevious->pxNextFreeBlock;
+				}
+
+				heapBUMP_LOCK();
+				{
+					/* A pool may have carved past the block meanwhile. */
+					if( pucBlockEnd == ( uint8_t * ) xRegion[ x ].pxFreeHeap )
+					{
+						xRegion[ x ].pxFreeHeap = ( void * ) pxBlock;
+						configASSERT( ( uint8_t * ) xRegion[ x ].pxFreeHeap >= xRegion[ x ].pucHeapStart );
+						xReleased = pdTRUE;
+					}
+				}
+				heapBUMP_UNLOCK();
+				break;
+			}
+		}
+	}
+	#endif
+
+	if( xReleased != pdFALSE )
+	{
+		/* The bytes were already counted as free, and stay so. */
+		pxPrevious->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+}
+/*-----------------------------------------------------------*/
+
+/* Prints the free lists over huart2.  Slow, and it holds nothing locked while
+it walks them - xPortGetHeapSnapshot(), or heap_trace.c for a record of every
+operation, give the same information without a UART. */
+void vPrintFreeList(void)
+{
+    char data[100];
+	Block_t *current;
+
+	sprintf(data, "StartAddress heapSTRUCT_SIZE xBlockSize EndAddress\n\r");
+	HAL_UART_Transmit(&huart2, (uint8_t *)data, strlen(data), 0xffff);
+
+	for (size_t i = 0; i < xPoolCount; ++i) {
+        current = heapPOOL_FIRST(&(xPool[i]));
+        while (current) {
+            sprintf(data, "%p         %d           %4d         %p\n\r", (void *)current, (int)heapPOOL_HEADER_SIZE, (int)(xPool[i].xBlockSize + heapPOOL_HEADER_SIZE), (void *)current + xPool[i].xBlockSize + heapPOOL_HEADER_SIZE);
+            HAL_UART_Transmit(&huart2, (uint8_t *)data, strlen(data), 0xffff);
+            current = current->pxNext;
+        }
+	}
+
+    for (LargeBlock_t *pxLarge = xLargeStart.pxNextFreeBlock; pxLarge != NULL; pxLarge = pxLarge->pxNextFreeBlock) {
+        sprintf(data, "%p         %d           %4d         %p\n\r", (void *)pxLarge, (int)heapSTRUCT_SIZE, (int)pxLarge->xBlockSize, (void *)pxLarge + pxLarge->xBlockSize);
+        HAL_UART_Transmit(&huart2, (uint8_t *)data, strlen(data), 0xffff);
+    }
+
+	sprintf(data, "xTotalHeapSize: %0d xFreeBytesRemaining: %0d\n\r", (int)xTotalHeapSize, (int)xFreeBytesRemaining);
+    HAL_UART_Transmit(&huart2, (uint8_t *)data, strlen(data), 0xffff);
+}
+
+/*
+ * A heap snapshot is a sequence of uint32_t words in the byte order of the
+ * target, so the decoder tells the order from the magic number:
+ *
+ *   heapSNAPSHOT_MAGIC, heapSNAPSHOT_VERSION, flags, heap size, free bytes,
+ *   minimum ever free bytes, unallocated bytes, pool count, free large blocks,
+ *   region count
+ *   then for each region:       offset, size
+ *   then for each pool:         block size, stride, number of free blocks
+ *   then for each free block:   offset, pools in order
+ *   then for each large block:  offset, size including its header
+ *
+ * Offsets are from the aligned start of the first region.  The counts are
+ * those of the records actually written, so a truncated snapshot is still well
+ * formed.
+ */
+#define heapSNAPSHOT_MAGIC			( ( uint32_t ) 0x48373737UL )	/* "H777" */
+#define heapSNAPSHOT_VERSION		( ( uint32_t ) 2UL )
+#define heapSNAPSHOT_TRUNCATED		( ( uint32_t ) 0x01UL )
+#define heapSNAPSHOT_SPANS			( ( uint32_t ) 0x02UL )
+#define heapSNAPSHOT_HEADER_WORDS	( ( size_t ) 10 )
+#define heapSNAPSHOT_REGION_WORDS	( ( size_t ) 2 )
+#define heapSNAPSHOT_POOL_WORDS		( ( size_t ) 3 )
+
+size_t xPortGetHeapSnapshot( uint8_t *pucBuffer, size_t xBufferLength )
+{
+size_t xOffset, xPoolTable, xCount;
+size_t xUnallocated = 0;
+uint32_t ulFlags = 0;
+Block_t *pxList, *pxBlock;
+LargeBlock_t *pxLarge;
+
+	prvEnsureInitialised();
+
+	if( ( pucBuffer == NULL ) || ( xBufferLength < ( ( heapSNAPSHOT_HEADER_WORDS + ( xRegionCount * heapSNAPSHOT_REGION_WORDS ) + ( xPoolCount * heapSNAPSHOT_POOL_WORDS ) ) * sizeof( uint32_t ) ) ) )
+	{
+		return 0;
+	}
+
+	#if( configHEAP_USE_SPANS == 1 )
+	{
+		ulFlags |= heapSNAPSHOT_SPANS;
+	}
+	#endif
+
+	/* The regions never change once the heap is initialised. */
+	xPoolTable = heapSNAPSHOT_HEADER_WORDS * sizeof( uint32_t );
+	for( size_t i = 0; i < xRegionCount; ++i )
+	{
+		xPoolTable = prvSnapshotPut( pucBuffer, xPoolTable, ( uint32_t ) ( xRegion[ i ].pucHeapStart - xRegion[ 0 ].pucHeapStart ) );
+		xPoolTable = prvSnapshotPut( pucBuffer, xPoolTable, ( uint32_t ) xRegion[ i ].xRegionSize );
+	}
+
+	/* Skip the header and pool table, they are filled in once the counts are
+	known. */
+	xOffset = xPoolTable + ( xPoolCount * heapSNAPSHOT_POOL_WORDS * sizeof( uint32_t ) );
+
+	/* Only pointer chasing and word stores happen while the heap is locked.
+	Sending the snapshot anywhere is left to the caller. */
+	vTaskSuspendAll();
+	{
+		for( size_t i = 0; i < xPoolCount; ++i )
+		{
+			xCount = 0;
+
+			heapPOOL_LOCK();
+			{
+				/* Without a lock an interrupt could take a block off the list
+				mid walk, so the list is taken while it is walked.  The pool
+				looks empty meanwhile. */
+				#if( configHEAP_USE_LOCK_FREE_POOLS == 1 )
+				{
+					heapPOOL_DETACH( &( xPool[ i ] ), pxList );
+				}
+				#else
+				{
+					pxList = heapPOOL_FIRST( &( xPool[ i ] ) );
+				}
+				#endif
+
+				for( pxBlock = pxList; pxBlock != NULL; pxBlock = pxBlock->pxNext )
+				{
+					if( ( xBufferLength - xOffset ) < sizeof( uint32_t ) )
+					{
+						ulFlags |= heapSNAPSHOT_TRUNCATED;
+						break;
+					}
+
+					xOffset = prvSnapshotPut( pucBuffer, xOffset, ( uint32_t ) ( ( uint8_t * ) pxBlock - xRegion[ 0 ].pucHeapStart ) );
+					++xCount;
+				}
+
+				#if( configHEAP_USE_LOCK_FREE_POOLS == 1 )
+				{
+					if( pxList != NULL )
+					{
+						for( pxBlock = pxList; pxBlock->pxNext != NULL; pxBlock = pxBlock->pxNext )
+						{
+							/* Just find the end of the list. */
+						}
+
+						heapPOOL_PUSH( &( xPool[ i ] ), pxList, pxBlock );
+					}
+				}
+				#endif
+			}
+			heapPOOL_UNLOCK();
+
+			xPoolTable = prvSnapshotPut( pucBuffer, xPoolTable, ( uint32_t ) xPool[ i ].xBlockSize );
+			xPoolTable = prvSnapshotPut( pucBuffer, xPoolTable, ( uint32_t ) heapPOOL_STRIDE( xPool[ i ].xBlockSize ) );
+			xPoolTable = prvSnapshotPut( pucBuffer, xPoolTable, ( uint32_t ) xCount );
+		}
+
+		xCount = 0;
+		for( pxLarge = xLargeStart.pxNextFreeBlock; pxLarge != NULL; pxLarge = pxLarge->pxNextFreeBlock )
+		{
+			if( ( xBufferLength - xOffset ) < ( 2 * sizeof( uint32_t ) ) )
+			{
+				ulFlags |= heapSNAPSHOT_TRUNCATED;
+				break;
+			}
+
+			xOffset = prvSnapshotPut( pucBuffer, xOffset, ( uint32_t ) ( ( uint8_t * ) pxLarge - xRegion[ 0 ].pucHeapStart ) );
+			xOffset = prvSnapshotPut( pucBuffer, xOffset, ( uint32_t ) pxLarge->xBlockSize );
+			++xCount;
+		}
+
+		heapPOOL_LOCK();
+		{
+			for( size_t i = 0; i < xRegionCount; ++i )
+			{
+				xUnallocated += heapUNCARVED_BYTES( &( xRegion[ i ] ) );
+			}
+
+			( void ) prvSnapshotPut( pucBuffer, 0 * sizeof( uint32_t ), heapSNAPSHOT_MAGIC );
+			( void ) prvSnapshotPut( pucBuffer, 1 * sizeof( uint32_t ), heapSNAPSHOT_VERSION );
+			( void ) prvSnapshotPut( pucBuffer, 2 * sizeof( uint32_t ), ulFlags );
+			( void ) prvSnapshotPut( pucBuffer, 3 * sizeof( uint32_t ), ( uint32_t ) xTotalHeapSize );
+			( void ) prvSnapshotPut( pucBuffer, 4 * sizeof( uint32_t ), ( uint32_t ) xFreeBytesRemaining );
+			( void ) prvSnapshotPut( pucBuffer, 5 * sizeof( uint32_t ), ( uint32_t ) xMinimumEverFreeBytesRemaining );
+			( void ) prvSnapshotPut( pucBuffer, 6 * sizeof( uint32_t ), ( uint32_t ) xUnallocated );
+			( void ) prvSnapshotPut( pucBuffer, 7 * sizeof( uint32_t ), ( uint32_t ) xPoolCount );
+			( void ) prvSnapshotPut( pucBuffer, 8 * sizeof( uint32_t ), ( uint32_t ) xCount );
+			( void ) prvSnapshotPut( pucBuffer, 9 * sizeof( uint32_t ), ( uint32_t ) xRegionCount );
+		}
+		heapPOOL_UNLOCK();
+	}
+	( void ) xTaskResumeAll();
+
+	return xOffset;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvSnapshotPut( uint8_t *pucBuffer, size_t xOffset, uint32_t ulValue )
+{
+	memcpy( &( pucBuffer[ xOffset ] ), &ulValue, sizeof( ulValue ) );
+	return xOffset + sizeof( ulValue );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t vPortPoolInit( const size_t *pxSizeList, const size_t *pxReserveList, size_t xListLength )
+{
+    return vPortPoolInitRegions(pxSizeList, pxReserveList, NULL, xListLength);
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t vPortPoolInitRegions( const size_t *pxSizeList, const size_t *pxReserveList, const size_t *pxRegionList, size_t xListLength )
+{
+size_t xSortedList[heapMAXIMUM_POOL_NUM];
+size_t xSortedReserve[heapMAXIMUM_POOL_NUM];
+size_t xSortedRegion[heapMAXIMUM_POOL_NUM];
+size_t xRoom[heapMAXIMUM_REGION_NUM] = { 0 };
+size_t xSortedLength = 0;
+size_t xSize, xReserve, xStride, xFits, xArea, j;
+BaseType_t xReturn = pdFALSE;
+
+    if ((pxSizeList == NULL) || (xListLength == 0) || (xListLength > heapMAXIMUM_POOL_NUM))
+        return pdFALSE;
+
+    /* Round every size up to the byte alignment, then insertion sort the list
+    and drop duplicates so the class lookup always finds the tightest fit. */
+    for (size_t i = 0; i < xListLength; ++i) {
+        xSize = pxSizeList[i];
+        xReserve = (pxReserveList != NULL) ? pxReserveList[i] : 0;
+
+        if ((xSize == 0) || (xSize > configHEAP_MAXIMUM_POOL_BLOCK_SIZE))
+            return pdFALSE;
+
+        if( ( xSize & portBYTE_ALIGNMENT_MASK ) != 0 )
+        {
+            xSize += ( portBYTE_ALIGNMENT - ( xSize & portBYTE_ALIGNMENT_MASK ) );
+        }
+
+        /* A free block must still be able to hold its list link. */
+        if (xSize < sizeof(Block_t)) {
+            xSize = (sizeof(Block_t) + portBYTE_ALIGNMENT_MASK) & ~((size_t)portBYTE_ALIGNMENT_MASK);
+        }
+
+        for (j = xSortedLength; (j > 0) && (xSortedList[j - 1] > xSize); --j) {
+            /* Nothing to do here, just find the insertion point. */
+        }
+
+        if ((j == 0) || (xSortedList[j - 1] != xSize)) {
+            for (size_t k = xSortedLength; k > j; --k) {
+                xSortedList[k] = xSortedList[k - 1];
+                xSortedReserve[k] = xSortedReserve[k - 1];
+                xSortedRegion[k] = xSortedRegion[k - 1];
+            }
+            xSortedList[j] = xSize;
+            xSortedReserve[j] = xReserve;
+            xSortedRegion[j] = (pxRegionList != NULL) ? pxRegionList[i] : 0;
+            ++xSortedLength;
+        } else {
+            /* Sizes that round to the same pool share its reservation, and
+            keep the region of the first of them. */
+            xSortedReserve[j - 1] += xReserve;
+        }
+    }
+
+#ifdef configHEAP_POOL_CLASSES
+    /* The pools are fixed at compile time, so only the reservations and
+    regions of the classes can be chosen here. */
+    if (xSortedLength != heapCLASS_COUNT)
+        return pdFALSE;
+
+    for (size_t i = 0; i < xSortedLength; ++i) {
+        if (xSortedList[i] != xSizeList[i])
+            return pdFALSE;
+    }
+#endif
+
+    vTaskSuspendAll();
+	{
+        /* The pools can only be laid out before the first allocation. */
+        if (xPoolHasBeenInitialised == pdFALSE) {
+            if(xHeapHasBeenInitialised == pdFALSE)
+            {
+                prvHeapInit();
+                xHeapHasBeenInitialised = pdTRUE;
+            }
+
+            for (size_t k = 0; k < xRegionCount; ++k) {
+                xRoom[k] = heapUNCARVED_BYTES(&(xRegion[k]));
+            }
+
+            /* Check the whole reservation fits before touching the heap, so
+            an oversized memory budget is reported here rather than by the
+            first failed allocation.  The blocks are placed just as
+            prvReservePoolBlocks() will place them - in the preferred region
+            until it is full, then in the others in order. */
+            xReturn = pdTRUE;
+            for (size_t i = 0; (i < xSortedLength) && (xReturn == pdTRUE); ++i) {
+                xStride = heapPOOL_STRIDE(xSortedList[i]);
+#if( configHEAP_USE_SPANS == 1 )
+                /* Reservations are carved in whole spans. */
+                xReserve = (xSortedReserve[i] + ((prvSpanSizeFor(xStride) / xStride) - 1)) / (prvSpanSizeFor(xStride) / xStride);
+                xStride = prvSpanSizeFor(xStride);
+#else
+                xReserve = xSortedReserve[i];
+#endif
+                if (xSortedRegion[i] >= xRegionCount) {
+                    xReturn = pdFALSE;
+                }
+
+                for (size_t k = 0; (k < xRegionCount) && (xReturn == pdTRUE) && (xReserve > 0); ++k) {
+                    xArea = heapREGION_ORDER(xSortedRegion[i], k);
+                    xFits = xRoom[xArea] / xStride;
+                    if (xFits > xReserve) {
+                        xFits = xReserve;
+                    }
+                    xRoom[xArea] -= xFits * xStride;
+                    xReserve -= xFits;
+                }
+
+                if (xReserve > 0) {
+                    xReturn = pdFALSE;
+                }
+            }
+
+            if (xReturn == pdTRUE) {
+                prvPoolInit(xSortedList, xSortedRegion, xSortedLength);
+
+                for (size_t i = 0; i < xSortedLength; ++i) {
+                    prvReservePoolBlocks(&(xPool[i]), xSortedReserve[i], heapPOOL_STRIDE(xSortedList[i]));
+                }
+            } else {
+                xReturn = pdFALSE;
+            }
+        }
+	}
+	( void ) xTaskResumeAll();
+
+    return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPoolInit( const size_t *pxSizeList, const size_t *pxRegionList, size_t xListLength )
+{
+#ifndef configHEAP_POOL_CLASSES
+size_t xPoolIndex = 0;
+#endif
+
+    for (size_t i = 0; i < xListLength; ++i) {
+        memset(&(xPool[i]), 0, sizeof(Pool_t));
+        xPool[i].xBlockSize = pxSizeList[i];
+        xPool[i].xRegion = (pxRegionList != NULL) ? pxRegionList[i] : 0;
+#if( configHEAP_USE_SPANS == 1 )
+        xPool[i].xSpanSize = prvSpanSizeFor(heapPOOL_STRIDE(pxSizeList[i]));
+#endif
+    }
+    xPoolCount = xListLength;
+
+#ifndef configHEAP_POOL_CLASSES
+    /* Record the smallest fitting pool for every size up to
+    configHEAP_MAXIMUM_POOL_BLOCK_SIZE. */
+    for (size_t i = 0; i < heapPOOL_INDEX_SIZE; ++i) {
+        while ((xPoolIndex < xPoolCount) && (xPool[xPoolIndex].xBlockSize < (i * portBYTE_ALIGNMENT))) {
+            ++xPoolIndex;
+        }
+        ucPoolIndex[i] = (uint8_t)((xPoolIndex < xPoolCount) ? xPoolIndex : heapMAXIMUM_POOL_NUM);
+    }
+#else
+    /* The classes are looked up by heapPOOL_CLASS_OF(), so the pools must be
+    exactly the classes in order. */
+    configASSERT(xPoolCount == heapCLASS_COUNT);
+#endif
+
+    xPoolHasBeenInitialised = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReservePoolBlocks( Pool_t *pxPoolToFill, size_t xBlockCount, size_t xStride )
+{
+#if( configHEAP_USE_SPANS == 1 )
+size_t xPerSpan = pxPoolToFill->xSpanSize / xStride;
+
+    /* Spans are pushed in front of each other, so carve whole spans until the
+    reservation is covered. */
+    for (size_t i = 0; i < xBlockCount; i += xPerSpan) {
+        ( void ) prvCarveSpan((size_t)(pxPoolToFill - xPool));
+    }
+#else
+Block_t *pxFirst = NULL, *pxLast = NULL;
+Block_t *pxBlock;
+
+    /* Chain the blocks in address order, the pool's list is still empty so
+    they are handed out in that order. */
+    for (size_t i = 0; i < xBlockCount; ++i) {
+        pxBlock = prvCarve(pxPoolToFill->xRegion, heapALL_REGIONS, xStride);
+        configASSERT(pxBlock != NULL);
+        if (pxBlock == NULL) {
+            break;
+        }
+
+        pxBlock->pxPool = pxPoolToFill;
+        if (pxFirst == NULL) {
+            pxFirst = pxBlock;
+        } else {
+            pxLast->pxNext = pxBlock;
+        }
+        pxLast = pxBlock;
+        pxPoolToFill->xBlocksCarved++;
+    }
+
+    if (pxFirst != NULL) {
+        heapPOOL_PUSH(pxPoolToFill, pxFirst, pxLast);
+    }
+#endif
+}
+/*-----------------------------------------------------------*/
+
+static void prvPushChainToPool( Block_t *pxHead, Block_t *pxTail, size_t xChainLength )
+{
+Pool_t *pxChainPool = heapPOOL_OF( pxHead );
+
+	heapPOOL_LOCK();
+	{
+		heapPOOL_PUSH( pxChainPool, pxHead, pxTail );
+		heapPOOL_RETURN_BLOCKS( pxChainPool, xChainLength );
+	}
+	heapPOOL_UNLOCK();
+}
+/*-----------------------------------------------------------*/
+
+#if( configHEAP_USE_GUARDS == 1 )
+
+	static size_t prvGuardUsableSize( void *pv )
+	{
+	size_t xUsableSize;
+
+		if( heapIS_LARGE_BLOCK( pv ) )
+		{
+			xUsableSize = ( ( ( LargeBlock_t * ) ( void * ) ( ( uint8_t * ) pv - heapSTRUCT_SIZE ) )->xBlockSize & ~heapLARGE_BLOCK_BIT ) - heapSTRUCT_SIZE;
+		}
+		else
+		{
+			xUsableSize = heapPOOL_OF( heapUSER_TO_BLOCK( pv ) )->xBlockSize;
+		}
+
+		return xUsableSize;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvGuardArm( void *pv, size_t xRequestedSize )
+	{
+		if( pv != NULL )
+		{
+			#if( configHEAP_USE_SPANS == 0 )
+			{
+				if( !heapIS_LARGE_BLOCK( pv ) )
+				{
+					heapUSER_TO_BLOCK( pv )->pxPool = ( Pool_t * ) ( void * ) ( ( portPOINTER_SIZE_TYPE ) heapUSER_TO_BLOCK( pv )->pxPool | heapPOOL_ALLOCATED_BIT );
+				}
+			}
+			#endif
+
+			vPortHeapGuardArm( pv, xRequestedSize, prvGuardUsableSize( pv ) );
+		}
+	}
+	/*-----------------------------------------------------------*/
 
-/*
- * Initialises the heap structures before their first use.
- */
-static void prvHeapInit( void );
-static BaseType_t xPortPoolInit(size_t *);
+	static BaseType_t prvGuardCheck( void *pv )
+	{
+	uint8_t *puc = ( uint8_t * ) pv;
+	BaseType_t xValid = pdFALSE;
 
-/* Allocate the memory for the heap. */
-#if( configAPPLICATION_ALLOCATED_HEAP == 1 )
-	/* The application writer has already defined the array used for the RTOS
-	heap - probably so it can be placed in a special segment or address. */
-	extern uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
-#else
-	static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
-#endif /* configAPPLICATION_ALLOCATED_HEAP */
+		if( heapIS_LARGE_BLOCK( pv ) )
+		{
+		LargeBlock_t *pxBlock = ( void * ) ( puc - heapSTRUCT_SIZE );
+		size_t xBlockSize = pxBlock->xBlockSize & ~heapLARGE_BLOCK_BIT;
 
-/* Define the linked list structure. Block_t is used to link free blocks with
- * same size, and Pool_t is used to record the head of each list.
- */
-typedef struct Pool Pool_t;
-typedef struct Block Block_t;
+			/* A freed large block has lost its bit.  One in use must also fit
+			the region it starts in. */
+			for( size_t i = 0; i < xRegionCount; ++i )
+			{
+				if( ( ( uint8_t * ) pxBlock >= xRegion[ i ].pucHeapStart ) && ( ( uint8_t * ) pxBlock < ( xRegion[ i ].pucHeapStart + xRegion[ i ].xRegionSize ) ) )
+				{
+					if( ( ( pxBlock->xBlockSize & heapLARGE_BLOCK_BIT ) != 0 ) && ( xBlockSize > heapSTRUCT_SIZE ) &&
+						( xBlockSize <= ( size_t ) ( ( xRegion[ i ].pucHeapStart + xRegion[ i ].xRegionSize ) - ( uint8_t * ) pxBlock ) ) )
+					{
+						xValid = pdTRUE;
+					}
+					break;
+				}
+			}
+		}
+		else
+		{
+			#if( configHEAP_USE_SPANS == 1 )
+			{
+			uint8_t *pucSpan = NULL;
+			size_t xPage, xIndex, xStride, xOffset;
 
-struct Pool
-{
-    Block_t *pxFirstFree;   /* The first free block in this pool. */
-    size_t xBlockSize;      /* The size of the free block in this pool. */
-};
+				if( ( puc >= xRegion[ 0 ].pucHeapStart ) && ( puc < ( uint8_t * ) xRegion[ 0 ].pxFreeHeap ) )
+				{
+					/* Walk back to the first page of the span.  Every page on
+					the way must belong to the same pool, and a span given back
+					to the reserve has no first page. */
+					xPage = heapPAGE_OF( puc );
+					xIndex = ucSpanMap[ xPage ];
 
-struct Block
-{
-    Pool_t *pxPool;         /* The pool this block belongs to. */
-    Block_t *pxNext;        /* The next free block in the list. */
-};
+					for( size_t xBack = 0; ( xBack < heapSPAN_MAX_PAGES ) && ( xBack <= xPage ); ++xBack )
+					{
+						if( ucSpanMap[ xPage - xBack ] != xIndex )
+						{
+							break;
+						}
 
-static const uint16_t heapSTRUCT_SIZE	= ( ( sizeof ( Block_t ) + ( portBYTE_ALIGNMENT - 1 ) ) & ~portBYTE_ALIGNMENT_MASK );
-#define heapMINIMUM_BLOCK_SIZE	( ( size_t ) ( heapSTRUCT_SIZE * 2 ) )
+						if( heapIS_SPAN_START( xRegion[ 0 ].pucHeapStart + ( ( xPage - xBack ) * configHEAP_SPAN_PAGE_SIZE ) ) )
+						{
+							pucSpan = xRegion[ 0 ].pucHeapStart + ( ( xPage - xBack ) * configHEAP_SPAN_PAGE_SIZE );
+							break;
+						}
+					}
 
-#define heapMAXIMUM_POOL_NUM 10
-const size_t xSizeList[heapMAXIMUM_POOL_NUM] = { 80, 160, 240, 320, 400, 480, 560, 640, 720, 1000 };
+					if( ( pucSpan != NULL ) && ( xIndex < xPoolCount ) )
+					{
+						xStride = heapPOOL_STRIDE( xPool[ xIndex ].xBlockSize );
+						xOffset = ( size_t ) ( puc - pucSpan );
 
-static BaseType_t xHeapHasBeenInitialised = pdFALSE;
-static BaseType_t xPoolHasBeenInitialised = pdFALSE;
+						if( ( xOffset < ( ( xPool[ xIndex ].xSpanSize / xStride ) * xStride ) ) && ( ( xOffset % xStride ) == 0 ) )
+						{
+							xValid = pdTRUE;
+						}
+					}
+				}
+			}
+			#else
+			{
+			Block_t *pxBlock = heapUSER_TO_BLOCK( pv );
+			Pool_t *pxOwner = heapPOOL_OF( pxBlock );
 
-/* Create a couple of pools. */
-static Pool_t xPool[heapMAXIMUM_POOL_NUM];
+				/* The header must name one of the pools, and say the block is
+				in use. */
+				if( ( ( ( portPOINTER_SIZE_TYPE ) pxBlock->pxPool & heapPOOL_ALLOCATED_BIT ) != 0 ) &&
+					( pxOwner >= &( xPool[ 0 ] ) ) && ( pxOwner < &( xPool[ xPoolCount ] ) ) &&
+					( ( ( size_t ) ( ( uint8_t * ) pxOwner - ( uint8_t * ) xPool ) % sizeof( Pool_t ) ) == 0 ) )
+				{
+					xValid = pdTRUE;
+				}
+			}
+			#endif
+		}
 
-/* Keeps track of the unallocated heap's head. */
-Block_t *pxFreeHeap = NULL;
+		if( xValid == pdTRUE )
+		{
+			xValid = xPortHeapGuardCheck( pv, prvGuardUsableSize( pv ) );
+		}
 
-/* Keeps track of the number of free bytes remaining, but says nothing about
-fragmentation. */
-static size_t xFreeBytesRemaining = configADJUSTED_HEAP_SIZE;
+		if( xValid == pdFALSE )
+		{
+			configHEAP_GUARD_FAILED( pv );
+		}
 
-/* STATIC FUNCTIONS ARE DEFINED AS MACROS TO MINIMIZE THE FUNCTION CALL DEPTH. */
+		return xValid;
+	}
+	/*-----------------------------------------------------------*/
+
+	static BaseType_t prvGuardRelease( void *pv )
+	{
+	BaseType_t xReturn = prvGuardCheck( pv );
+
+		if( xReturn == pdTRUE )
+		{
+			#if( configHEAP_USE_SPANS == 0 )
+			{
+				if( !heapIS_LARGE_BLOCK( pv ) )
+				{
+					heapUSER_TO_BLOCK( pv )->pxPool = heapPOOL_OF( heapUSER_TO_BLOCK( pv ) );
+				}
+			}
+			#endif
 
+			vPortHeapGuardPoison( pv, prvGuardUsableSize( pv ) );
+		}
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* configHEAP_USE_GUARDS */
+
+static size_t prvPopBlocks( size_t xPoolIndex, void *ppvBlocks[], size_t xCount )
+{
+Block_t *pxBlock;
+size_t xPopped = 0;
+
+	heapPOOL_LOCK();
+	{
+		while( xPopped < xCount )
+		{
+			heapPOOL_POP( &( xPool[ xPoolIndex ] ), pxBlock );
+			if( pxBlock == NULL )
+			{
+				break;
+			}
+
+			ppvBlocks[ xPopped++ ] = heapBLOCK_TO_USER( pxBlock );
+		}
+		heapPOOL_CLAIM_BLOCKS( &( xPool[ xPoolIndex ] ), xPopped );
+	}
+	heapPOOL_UNLOCK();
+
+	return xPopped;
+}
 /*-----------------------------------------------------------*/
 
-void *pvPortMalloc( size_t xWantedSize )
+static void prvGiveBackBatch( size_t xPoolIndex, void *ppvBlocks[], size_t xCount )
 {
-void *pvReturn = NULL;
-int iter = 0;
+Block_t *pxHead = NULL, *pxTail = NULL, *pxLink;
 
-	vTaskSuspendAll();
+	for( size_t i = 0; i < xCount; ++i )
 	{
-		/* If this is the first call to malloc then the heap will require
-		initialization. */
-		if( xHeapHasBeenInitialised == pdFALSE )
+		pxLink = heapUSER_TO_BLOCK( ppvBlocks[ i ] );
+		if( pxHead == NULL )
 		{
-			prvHeapInit();
-			xHeapHasBeenInitialised = pdTRUE;
-            xPortPoolInit(xSizeList);
+			pxTail = pxLink;
 		}
+		pxLink->pxNext = pxHead;
+		pxHead = pxLink;
+	}
 
-		/* The wanted size is increased so it can contain a Block_t
-		structure in addition to the requested amount of bytes. */
-		if( xWantedSize > 0 )
+	if( pxHead != NULL )
+	{
+		heapPOOL_LOCK();
 		{
-            /* Find the best-fit size from the pool size. */
-            for (iter = 0; iter < heapMAXIMUM_POOL_NUM; ++iter) {
-                if (xPool[iter].xBlockSize >= xWantedSize) {
-                    xWantedSize = xPool[iter].xBlockSize;
-                    break;
-                }
-            }
+			heapPOOL_PUSH( &( xPool[ xPoolIndex ] ), pxHead, pxTail );
+			heapPOOL_RETURN_BLOCKS( &( xPool[ xPoolIndex ] ), xCount );
+		}
+		heapPOOL_UNLOCK();
+	}
+}
+/*-----------------------------------------------------------*/
+
+#if( configHEAP_USE_LOCK_FREE_POOLS == 1 )
 
-			xWantedSize += heapSTRUCT_SIZE;
+	static Block_t *prvPoolPop( Pool_t *pxOwner )
+	{
+	size_t xHead;
+	Block_t *pxBlock;
+
+		do
+		{
+			xHead = pxOwner->xFirstFree;
+			pxBlock = heapHEAD_BLOCK( xHead );
 
-			/* Ensure that blocks are always aligned to the required number of bytes. */
-			if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0 )
+			if( pxBlock == NULL )
 			{
-				/* Byte alignment required. */
-				xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+				break;
 			}
-		}
 
-		if( ( xWantedSize > 0 ) && ( xWantedSize < xFreeBytesRemaining ) )
+			/* If the block was taken since the head was read its pxNext may
+			be anything by now, but the tag has moved on so the swap fails.
+			The block is still heap memory, so reading it is harmless. */
+		} while( !configHEAP_ATOMIC_CAS( &( pxOwner->xFirstFree ), xHead, heapHEAD_NEXT( xHead, pxBlock->pxNext ) ) );
+
+		return pxBlock;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvPoolPush( Pool_t *pxOwner, Block_t *pxFirst, Block_t *pxLast )
+	{
+	size_t xHead;
+
+		do
 		{
-            if (xPool[iter].pxFirstFree != NULL) {
+			xHead = pxOwner->xFirstFree;
+			pxLast->pxNext = heapHEAD_BLOCK( xHead );
+		} while( !configHEAP_ATOMIC_CAS( &( pxOwner->xFirstFree ), xHead, heapHEAD_NEXT( xHead, pxFirst ) ) );
+	}
+	/*-----------------------------------------------------------*/
+
+	static Block_t *prvPoolDetach( Pool_t *pxOwner )
+	{
+	size_t xHead;
 
-                /* Return the memory space - jumping over the Block_t structure at its 
-                start. */
-                pvReturn = (void *)((uint8_t *)xPool[iter].pxFirstFree + heapSTRUCT_SIZE);
+		do
+		{
+			xHead = pxOwner->xFirstFree;
+		} while( !configHEAP_ATOMIC_CAS( &( pxOwner->xFirstFree ), xHead, heapHEAD_NEXT( xHead, NULL ) ) );
 
-                /* This block is being returned for use so must be taken out of the
-				list of free blocks. */
-                xPool[iter].pxFirstFree = xPool[iter].pxFirstFree->pxNext;
+		return heapHEAD_BLOCK( xHead );
+	}
+	/*-----------------------------------------------------------*/
 
-            } else {
-				
-                /* The heap is to be split into two. Create a new block
-                following the number of bytes requested. The void cast is
-                used to prevent byte alignment warnings from the compiler. */
-                pxFreeHeap->pxPool = &(xPool[iter]);
-                pvReturn = (void *)((uint8_t *)pxFreeHeap + heapSTRUCT_SIZE);
-                pxFreeHeap = (void *)((uint8_t *)pxFreeHeap + xWantedSize);
+#endif /* configHEAP_USE_LOCK_FREE_POOLS */
 
+#if( configHEAP_USE_SPANS == 1 )
+
+	static size_t prvSpanSizeFor( size_t xStride )
+	{
+	size_t xPages, xBytes, xWaste;
+	size_t xBestBytes = 0, xBestWaste = 0;
+
+		for( xPages = 1; xPages <= heapSPAN_MAX_PAGES; xPages++ )
+		{
+			xBytes = xPages * configHEAP_SPAN_PAGE_SIZE;
+
+			if( xBytes < xStride )
+			{
+				continue;
+			}
+
+			xWaste = xBytes % xStride;
+
+			/* Compare xWaste / xBytes against the best so far without
+			dividing. */
+			if( ( xBestBytes == 0 ) || ( ( xWaste * xBestBytes ) < ( xBestWaste * xBytes ) ) )
+			{
+				xBestBytes = xBytes;
+				xBestWaste = xWaste;
+			}
+
+			if( ( xWaste * 8 ) <= xBytes )
+			{
+				break;
 			}
-            xFreeBytesRemaining -= xPool[iter].xBlockSize;
 		}
+
+		return xBestBytes;
 	}
-	( void ) xTaskResumeAll();
+	/*-----------------------------------------------------------*/
 
-	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	static BaseType_t prvCarveSpan( size_t xPoolIndex )
 	{
-		if( pvReturn == NULL )
+	Pool_t *pxOwner = &( xPool[ xPoolIndex ] );
+	size_t xStride = heapPOOL_STRIDE( pxOwner->xBlockSize );
+	size_t xBlocks = pxOwner->xSpanSize / xStride;
+	size_t xPage, x;
+	uint8_t *pucSpan = NULL;
+	Block_t *pxBlock;
+	BaseType_t xReclaimed = pdFALSE;
+
+		for( ;; )
 		{
-			extern void vApplicationMallocFailedHook( void );
-			vApplicationMallocFailedHook();
+			/* Reuse the spans other pools have given back before eating into
+			the unallocated heap, which the large blocks also need. */
+			heapBUMP_LOCK();
+			{
+				pucSpan = prvTakeReservedSpan( pxOwner->xSpanSize / configHEAP_SPAN_PAGE_SIZE );
+
+				if( ( pucSpan == NULL ) && heapCAN_CARVE( &( xRegion[ 0 ] ), pxOwner->xSpanSize ) )
+				{
+					pucSpan = ( uint8_t * ) xRegion[ 0 ].pxFreeHeap;
+					xRegion[ 0 ].pxFreeHeap = ( void * ) ( pucSpan + pxOwner->xSpanSize );
+				}
+			}
+			heapBUMP_UNLOCK();
+
+			/* The memory might be sitting in complete spans on the other
+			pools' free lists.  Look for them once before giving up. */
+			if( ( pucSpan != NULL ) || ( xReclaimed != pdFALSE ) )
+			{
+				break;
+			}
+
+			xReclaimed = pdTRUE;
+			if( prvReclaimSpans() == 0 )
+			{
+				break;
+			}
+		}
+
+		if( pucSpan == NULL )
+		{
+			return pdFALSE;
 		}
+
+		/* The span is private until it is pushed, so needs no lock. */
+		for( xPage = heapPAGE_OF( pucSpan ); xPage < heapPAGE_OF( pucSpan + pxOwner->xSpanSize ); xPage++ )
+		{
+			ucSpanMap[ xPage ] = ( uint8_t ) xPoolIndex;
+		}
+		heapBUMP_LOCK();
+		{
+			/* Other spans' bits share the word. */
+			heapSPAN_START_WORD( pucSpan ) |= heapSPAN_START_BIT( pucSpan );
+		}
+		heapBUMP_UNLOCK();
+
+		pxBlock = ( void * ) pucSpan;
+		for( x = 1; x < xBlocks; x++ )
+		{
+			pxBlock->pxNext = ( void * ) ( ( uint8_t * ) pxBlock + xStride );
+			pxBlock = pxBlock->pxNext;
+		}
+
+		/* The span was already counted as free while it was unallocated heap,
+		so xFreeBytesRemaining does not change.  The bytes left over at the end
+		of the span are lost to it. */
+		heapPOOL_LOCK();
+		{
+			heapPOOL_PUSH( pxOwner, ( Block_t * ) ( void * ) pucSpan, pxBlock );
+			( void ) heapCOUNTER_ADD( pxOwner->xBlocksCarved, xBlocks );
+		}
+		heapPOOL_UNLOCK();
+
+		return pdTRUE;
 	}
-	#endif
+	/*-----------------------------------------------------------*/
 
-	return pvReturn;
-}
-/*-----------------------------------------------------------*/
+	static uint8_t *prvTakeReservedSpan( size_t xPages )
+	{
+	SpanRun_t **ppxRun, *pxRun, *pxRest;
+	uint8_t *pucSpan = NULL;
 
-void vPortFree( void *pv )
-{
-uint8_t *puc = ( uint8_t * ) pv;
-Block_t *pxLink;
+		/* First fit, taking the front of the run so the rest stays where it
+		is in the list. */
+		for( ppxRun = &pxSpanReserve; *ppxRun != NULL; ppxRun = &( ( *ppxRun )->pxNextRun ) )
+		{
+			pxRun = *ppxRun;
+
+			if( pxRun->xPages >= xPages )
+			{
+				pucSpan = ( uint8_t * ) pxRun;
+
+				if( pxRun->xPages == xPages )
+				{
+					*ppxRun = pxRun->pxNextRun;
+				}
+				else
+				{
+					pxRest = ( void * ) ( pucSpan + ( xPages * configHEAP_SPAN_PAGE_SIZE ) );
+					pxRest->pxNextRun = pxRun->pxNextRun;
+					pxRest->xPages = pxRun->xPages - xPages;
+					*ppxRun = pxRest;
+				}
 
-	if( pv != NULL )
+				xSpanReserveBytes -= xPages * configHEAP_SPAN_PAGE_SIZE;
+				break;
+			}
+		}
+
+		return pucSpan;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvReserveSpan( uint8_t *pucSpan, size_t xPages )
 	{
-		/* The memory being freed will have an Block_t structure immediately
-		before it. */
-		puc -= heapSTRUCT_SIZE;
+	SpanRun_t *pxRun = ( void * ) pucSpan;
+	SpanRun_t *pxPrevious = NULL, *pxNext = pxSpanReserve;
 
-		/* This unexpected casting is to keep some compilers from issuing
-		byte alignment warnings. */
-		pxLink = ( void * ) puc;
+		heapSPAN_START_WORD( pucSpan ) &= ~heapSPAN_START_BIT( pucSpan );
+		xSpanReserveBytes += xPages * configHEAP_SPAN_PAGE_SIZE;
 
-		vTaskSuspendAll();
+		while( ( pxNext != NULL ) && ( ( uint8_t * ) pxNext < pucSpan ) )
 		{
-			/* Add this block to the list of free blocks. */
-			pxLink->pxNext = pxLink->pxPool->pxFirstFree;
-            pxLink->pxPool->pxFirstFree = pxLink;
-			xFreeBytesRemaining += pxLink->pxPool->xBlockSize;
+			pxPrevious = pxNext;
+			pxNext = pxNext->pxNextRun;
+		}
+
+		pxRun->xPages = xPages;
+		pxRun->pxNextRun = pxNext;
+
+		if( ( pxNext != NULL ) && ( ( pucSpan + ( xPages * configHEAP_SPAN_PAGE_SIZE ) ) == ( uint8_t * ) pxNext ) )
+		{
+			pxRun->xPages += pxNext->xPages;
+			pxRun->pxNextRun = pxNext->pxNextRun;
+		}
+
+		if( pxPrevious == NULL )
+		{
+			pxSpanReserve = pxRun;
+		}
+		else if( ( ( uint8_t * ) pxPrevious + ( pxPrevious->xPages * configHEAP_SPAN_PAGE_SIZE ) ) == pucSpan )
+		{
+			pxPrevious->xPages += pxRun->xPages;
+			pxPrevious->pxNextRun = pxRun->pxNextRun;
+			pxRun = pxPrevious;
+		}
+		else
+		{
+			pxPrevious->pxNextRun = pxRun;
+		}
+
+		/* The top run, if it reaches the unallocated heap, goes back to it so
+		large blocks can use it too. */
+		if( ( pxRun->pxNextRun == NULL ) && ( ( ( uint8_t * ) pxRun + ( pxRun->xPages * configHEAP_SPAN_PAGE_SIZE ) ) == ( uint8_t * ) xRegion[ 0 ].pxFreeHeap ) )
+		{
+			xSpanReserveBytes -= pxRun->xPages * configHEAP_SPAN_PAGE_SIZE;
+			xRegion[ 0 ].pxFreeHeap = ( void * ) pxRun;
+
+			if( pxRun == pxSpanReserve )
+			{
+				pxSpanReserve = NULL;
+			}
+			else
+			{
+				/* pxPrevious is the run before pxRun, unless pxRun was merged
+				into it, in which case the list has to be walked again. */
+				for( pxPrevious = pxSpanReserve; pxPrevious->pxNextRun != pxRun; pxPrevious = pxPrevious->pxNextRun )
+				{
+					/* Nothing to do here, just find the run before. */
+				}
+				pxPrevious->pxNextRun = NULL;
+			}
 		}
-		( void ) xTaskResumeAll();
 	}
-}
-/*-----------------------------------------------------------*/
+	/*-----------------------------------------------------------*/
 
-size_t xPortGetFreeHeapSize( void )
-{
-	return xFreeBytesRemaining;
-}
-/*-----------------------------------------------------------*/
+	static size_t prvReclaimSpans( void )
+	{
+	size_t xSpans = 0;
 
-void vPortInitialiseBlocks( void )
-{
-	/* This just exists to keep the linker quiet. */
-}
-/*-----------------------------------------------------------*/
+		for( size_t i = 0; i < xPoolCount; ++i )
+		{
+			xSpans += prvReclaimPoolSpans( i );
+		}
 
-static void prvHeapInit( void )
-{
-uint8_t *pucAlignedHeap;
+		return xSpans;
+	}
+	/*-----------------------------------------------------------*/
 
-	/* Ensure the heap starts on a correctly aligned boundary. */
-	pucAlignedHeap = ( uint8_t * ) ( ( ( portPOINTER_SIZE_TYPE ) &ucHeap[ portBYTE_ALIGNMENT ] ) & ( ~( ( portPOINTER_SIZE_TYPE ) portBYTE_ALIGNMENT_MASK ) ) );
+	static size_t prvReclaimPoolSpans( size_t xPoolIndex )
+	{
+	Pool_t *pxOwner = &( xPool[ xPoolIndex ] );
+	size_t xStride = heapPOOL_STRIDE( pxOwner->xBlockSize );
+	size_t xPerSpan = pxOwner->xSpanSize / xStride;
+	size_t xSpans = 0, xFound;
+	Block_t *pxList, *pxLast, *pxNext, *pxKept = NULL, *pxKeptLast = NULL;
 
-	/* To start with there is a single free block that is sized to take up the
-	entire heap space. */
-	pxFreeHeap = ( void * ) pucAlignedHeap;
-}
-/*-----------------------------------------------------------*/
+		/* Work on the free list privately, so the pool's lock is only held to
+		take it and to put back what is left.  Allocations from the pool carve
+		a fresh span meanwhile, and frees start a new list. */
+		heapPOOL_LOCK();
+		{
+			heapPOOL_DETACH( pxOwner, pxList );
+		}
+		heapPOOL_UNLOCK();
 
-void vPrintFreeList(void)
-{
-    char data[100];
-	Block_t *current;
+		/* Once in address order, a span's blocks are all free if its first
+		block is followed by xPerSpan - 1 more, each a stride on. */
+		pxList = prvSortBlocks( pxList );
 
-	sprintf(data, "StartAddress heapSTRUCT_SIZE xBlockSize EndAddress\n\r");
-	HAL_UART_Transmit(&huart2, (uint8_t *)data, strlen(data), 0xffff);
+		while( pxList != NULL )
+		{
+			pxLast = pxList;
+			xFound = 1;
 
-	for (int i = 0; i < heapMAXIMUM_POOL_NUM; ++i) {
-        current = xPool[i].pxFirstFree;
-        while (current) {
-            sprintf(data, "%p         %d           %4d         %p\n\r", (void *)current, heapSTRUCT_SIZE, xPool[i].xBlockSize + heapSTRUCT_SIZE, (void *)current + xPool[i].xBlockSize + heapSTRUCT_SIZE);
-            HAL_UART_Transmit(&huart2, (uint8_t *)data, strlen(data), 0xffff);
-            current = current->pxNext;
-        }
+			if( heapIS_SPAN_START( pxList ) )
+			{
+				while( ( xFound < xPerSpan ) && ( pxLast->pxNext == ( void * ) ( ( uint8_t * ) pxLast + xStride ) ) )
+				{
+					pxLast = pxLast->pxNext;
+					xFound++;
+				}
+			}
+
+			/* The run header is about to be written over the span. */
+			pxNext = pxLast->pxNext;
+
+			if( xFound == xPerSpan )
+			{
+				heapBUMP_LOCK();
+				{
+					prvReserveSpan( ( uint8_t * ) pxList, pxOwner->xSpanSize / configHEAP_SPAN_PAGE_SIZE );
+				}
+				heapBUMP_UNLOCK();
+				xSpans++;
+			}
+			else
+			{
+				/* Keep the blocks looked at, they are all in one span. */
+				if( pxKept == NULL )
+				{
+					pxKept = pxList;
+				}
+				else
+				{
+					pxKeptLast->pxNext = pxList;
+				}
+				pxKeptLast = pxLast;
+			}
+
+			pxList = pxNext;
+		}
+
+		heapPOOL_LOCK();
+		{
+			if( pxKept != NULL )
+			{
+				heapPOOL_PUSH( pxOwner, pxKept, pxKeptLast );
+			}
+			( void ) heapCOUNTER_SUB( pxOwner->xBlocksCarved, xSpans * xPerSpan );
+		}
+		heapPOOL_UNLOCK();
+
+		return xSpans;
 	}
+	/*-----------------------------------------------------------*/
 
-	sprintf(data, "configADJUSTED_HEAP_SIZE: %0d xFreeBytesRemaining: %0d\n\r", configADJUSTED_HEAP_SIZE, xFreeBytesRemaining);
-    HAL_UART_Transmit(&huart2, (uint8_t *)data, strlen(data), 0xffff);
-}
+	static Block_t *prvSortBlocks( Block_t *pxList )
+	{
+	Block_t xHead, *pxTail, *pxLeft, *pxRight, *pxTake;
+	size_t xRunLength, xRuns, xLeftLength, xRightLength;
 
-static BaseType_t xPortPoolInit(size_t *pxSizeList)
-{
-    if (xPoolHasBeenInitialised == pdTRUE)
-        return pdFALSE;
-    
-    vTaskSuspendAll();
+		/* A bottom up merge sort, as heap_2.c uses for its deferred coalescing,
+		which needs neither recursion nor extra memory. */
+		xHead.pxNext = pxList;
+
+		for( xRunLength = 1; xHead.pxNext != NULL; xRunLength <<= 1 )
+		{
+			pxLeft = xHead.pxNext;
+			pxTail = &xHead;
+			xRuns = 0;
+
+			while( pxLeft != NULL )
+			{
+				xRuns++;
+
+				/* Step over the left run to find the start of the right run. */
+				pxRight = pxLeft;
+				for( xLeftLength = 0; ( xLeftLength < xRunLength ) && ( pxRight != NULL ); xLeftLength++ )
+				{
+					pxRight = pxRight->pxNext;
+				}
+				xRightLength = xRunLength;
+
+				while( ( xLeftLength > 0 ) || ( ( xRightLength > 0 ) && ( pxRight != NULL ) ) )
+				{
+					if( ( xLeftLength > 0 ) && ( ( xRightLength == 0 ) || ( pxRight == NULL ) || ( ( uint8_t * ) pxLeft < ( uint8_t * ) pxRight ) ) )
+					{
+						pxTake = pxLeft;
+						pxLeft = pxLeft->pxNext;
+						xLeftLength--;
+					}
+					else
+					{
+						pxTake = pxRight;
+						pxRight = pxRight->pxNext;
+						xRightLength--;
+					}
+
+					pxTail->pxNext = pxTake;
+					pxTail = pxTake;
+				}
+
+				pxLeft = pxRight;
+			}
+
+			pxTail->pxNext = NULL;
+
+			if( xRuns <= 1 )
+			{
+				break;
+			}
+		}
+
+		return xHead.pxNext;
+	}
+	/*-----------------------------------------------------------*/
+
+	size_t xPortReclaimPoolSpans( void )
 	{
-		if(xHeapHasBeenInitialised == pdFALSE)
+	size_t xSpans;
+
+		prvEnsureInitialised();
+
+		heapMALLOC_SUSPEND();
 		{
-			prvHeapInit();
-			xHeapHasBeenInitialised = pdTRUE;
+			xSpans = prvReclaimSpans();
 		}
-        // TODO: need to sort the size list?
-        for (int i = 0; i < heapMAXIMUM_POOL_NUM; ++i) {
-            xPool[i].pxFirstFree = NULL;
-            xPool[i].xBlockSize = *(pxSizeList + i);
-        }
-        xPoolHasBeenInitialised = pdTRUE;
+		heapMALLOC_RESUME();
+
+		return xSpans;
 	}
-	( void ) xTaskResumeAll();
 
-    return pdTRUE;
-}
+#endif /* configHEAP_USE_SPANS */
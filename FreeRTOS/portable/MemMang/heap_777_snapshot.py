@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+#
+# Decoder for the heap snapshots written by xPortGetHeapSnapshot() in
+# heap_777.c.
+#
+# A snapshot is a sequence of 32-bit words in the byte order of the target:
+#
+#   magic ("H777"), version, flags, heap size, free bytes,
+#   minimum ever free bytes, unallocated bytes, pool count, free large blocks,
+#   region count (from version 2)
+#   then for each region:       offset, size (from version 2)
+#   then for each pool:         block size, stride, number of free blocks
+#   then for each free block:   offset, pools in order
+#   then for each large block:  offset, size including its header
+#
+# Offsets are from the aligned start of the heap, or of its first region.
+#
+# Usage: heap_777_snapshot.py <snapshot.bin> [--blocks]
+
+import struct
+import sys
+
+MAGIC = 0x48373737
+VERSIONS = (1, 2)
+FLAG_TRUNCATED = 0x01
+FLAG_SPANS = 0x02
+HEADER_WORDS = {1: 9, 2: 10}
+REGION_WORDS = 2
+POOL_WORDS = 3
+
+
+class SnapshotError(Exception):
+    pass
+
+
+def check_length(words, index, count):
+    """Raises SnapshotError unless words holds count more words from index."""
+    if index + count > len(words):
+        raise SnapshotError("snapshot is shorter than its record counts")
+
+
+def decode(data):
+    """Returns the snapshot in data as a dictionary."""
+    if len(data) < HEADER_WORDS[1] * 4:
+        raise SnapshotError("snapshot is shorter than its header")
+
+    # The magic number gives the byte order of the target.
+    for order in ("<", ">"):
+        if struct.unpack_from(order + "I", data, 0)[0] == MAGIC:
+            break
+    else:
+        raise SnapshotError("bad magic number")
+
+    words = struct.unpack_from("%s%dI" % (order, len(data) // 4), data, 0)
+    if words[1] not in VERSIONS:
+        raise SnapshotError("unsupported version %d" % words[1])
+    header = words[:HEADER_WORDS[words[1]]]
+    if len(header) < HEADER_WORDS[words[1]]:
+        raise SnapshotError("snapshot is shorter than its header")
+
+    snapshot = {
+        "big_endian": order == ">",
+        "truncated": (header[2] & FLAG_TRUNCATED) != 0,
+        "spans": (header[2] & FLAG_SPANS) != 0,
+        "heap_size": header[3],
+        "free_bytes": header[4],
+        "minimum_ever_free_bytes": header[5],
+        "unallocated_bytes": header[6],
+        "regions": [],
+        "pools": [],
+        "large_blocks": [],
+    }
+
+    pool_count = header[7]
+    index = len(header)
+
+    if header[1] >= 2:
+        for _ in range(header[9]):
+            check_length(words, index, REGION_WORDS)
+            snapshot["regions"].append(tuple(words[index:index + REGION_WORDS]))
+            index += REGION_WORDS
+    else:
+        snapshot["regions"].append((0, header[3]))
+
+    for _ in range(pool_count):
+        check_length(words, index, POOL_WORDS)
+        block_size, stride, free_blocks = words[index:index + POOL_WORDS]
+        snapshot["pools"].append({"block_size": block_size, "stride": stride,
+                                  "free_blocks": [None] * free_blocks})
+        index += POOL_WORDS
+
+    for pool in snapshot["pools"]:
+        count = len(pool["free_blocks"])
+        check_length(words, index, count)
+        pool["free_blocks"] = list(words[index:index + count])
+        index += count
+
+    for _ in range(header[8]):
+        check_length(words, index, 2)
+        snapshot["large_blocks"].append((words[index], words[index + 1]))
+        index += 2
+
+    return snapshot
+
+
+def report(snapshot, show_blocks):
+    print("heap size           %8d" % snapshot["heap_size"])
+    print("free bytes          %8d" % snapshot["free_bytes"])
+    print("minimum ever free   %8d" % snapshot["minimum_ever_free_bytes"])
+    print("unallocated bytes   %8d" % snapshot["unallocated_bytes"])
+    if len(snapshot["regions"]) > 1:
+        for i, (offset, size) in enumerate(snapshot["regions"]):
+            print("region %d at 0x%08x %8d" % (i, offset, size))
+    if snapshot["spans"]:
+        print("pool blocks are carved in spans")
+    if snapshot["truncated"]:
+        print("WARNING: the snapshot was truncated, the lists below are incomplete")
+
+    print()
+    print("pool  block size  stride  free blocks  free bytes")
+    for i, pool in enumerate(snapshot["pools"]):
+        count = len(pool["free_blocks"])
+        print("%4d  %10d  %6d  %11d  %10d" % (i, pool["block_size"], pool["stride"],
+                                             count, count * pool["block_size"]))
+        if show_blocks:
+            for offset in sorted(pool["free_blocks"]):
+                print("        0x%08x" % offset)
+
+    large = snapshot["large_blocks"]
+    print()
+    print("free large blocks   %8d" % len(large))
+    print("free large bytes    %8d" % sum(size for _, size in large))
+    print("largest large block %8d" % max([size for _, size in large] or [0]))
+    if show_blocks:
+        for offset, size in large:
+            print("        0x%08x  %8d" % (offset, size))
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write("usage: %s <snapshot.bin> [--blocks]\n" % argv[0])
+        return 2
+
+    with open(argv[1], "rb") as f:
+        data = f.read()
+
+    try:
+        snapshot = decode(data)
+    except SnapshotError as e:
+        sys.stderr.write("%s: %s\n" % (argv[1], e))
+        return 1
+
+    report(snapshot, "--blocks" in argv[2:])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
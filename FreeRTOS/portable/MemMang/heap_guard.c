@@ -0,0 +1,135 @@
+/*
+ * FreeRTOS Kernel V10.2.1
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * Red zones and poisoning for the blocks of any of the heap implementations.
+ * Build this file along with the heap and set configHEAP_USE_GUARDS to 1.
+ *
+ * Each heap makes a block portHEAP_GUARD_OVERHEAD bytes bigger than requested
+ * and calls vPortHeapGuardArm() once it is allocated.  The bytes from the end
+ * of the request up to the last word of the block are filled with
+ * configHEAP_GUARD_CANARY, and the last word holds the requested size XORed
+ * with heapGUARD_KEY, so a trailer that is all canary, poison or zero bytes
+ * never passes for a size.  No header grows and nothing is kept on the side.
+ * On free the heap checks its own header, calls xPortHeapGuardCheck(), and,
+ * if both pass, vPortHeapGuardPoison() before the block goes back to the free
+ * list.  Poisoning a block also destroys its trailer, which is what catches a
+ * block being freed a second time on heaps that keep no allocated bit.
+ *
+ * Every call is proportional to the size of the block, so this is meant for
+ * debug builds only.
+ */
+#include <string.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configHEAP_USE_GUARDS == 1 )
+
+/* The byte the red zone is filled with. */
+#ifndef configHEAP_GUARD_CANARY
+	#define configHEAP_GUARD_CANARY		0xFD
+#endif
+
+/* The byte freed blocks are filled with. */
+#ifndef configHEAP_GUARD_POISON
+	#define configHEAP_GUARD_POISON		0xDD
+#endif
+
+#if( configHEAP_GUARD_BYTES < 1 )
+	#error configHEAP_GUARD_BYTES must be at least 1
+#endif
+
+/* 0xA5 in every byte of a size_t. */
+#define heapGUARD_KEY		( ( ( size_t ) -1 / 0xFFU ) * 0xA5U )
+
+/*-----------------------------------------------------------*/
+
+void vPortHeapGuardArm( void *pv, size_t xRequestedSize, size_t xUsableSize )
+{
+uint8_t *puc = ( uint8_t * ) pv;
+size_t xTrailer = xRequestedSize ^ heapGUARD_KEY;
+
+	if( pv != NULL )
+	{
+		configASSERT( ( xUsableSize >= portHEAP_GUARD_OVERHEAD ) && ( xRequestedSize <= ( xUsableSize - portHEAP_GUARD_OVERHEAD ) ) );
+
+		memset( puc + xRequestedSize, configHEAP_GUARD_CANARY, xUsableSize - sizeof( size_t ) - xRequestedSize );
+
+		/* The trailer need not be aligned. */
+		memcpy( puc + xUsableSize - sizeof( size_t ), &xTrailer, sizeof( size_t ) );
+	}
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortHeapGuardCheck( const void *pv, size_t xUsableSize )
+{
+const uint8_t *puc = ( const uint8_t * ) pv;
+size_t xRequestedSize, x;
+BaseType_t xReturn = pdFALSE;
+
+	if( xUsableSize >= portHEAP_GUARD_OVERHEAD )
+	{
+		memcpy( &xRequestedSize, puc + xUsableSize - sizeof( size_t ), sizeof( size_t ) );
+		xRequestedSize ^= heapGUARD_KEY;
+
+		/* A trailer that has been written over almost never decodes to a size
+		that fits the block. */
+		if( xRequestedSize <= ( xUsableSize - portHEAP_GUARD_OVERHEAD ) )
+		{
+			for( x = xRequestedSize; x < ( xUsableSize - sizeof( size_t ) ); ++x )
+			{
+				if( puc[ x ] != ( uint8_t ) configHEAP_GUARD_CANARY )
+				{
+					break;
+				}
+			}
+
+			if( x == ( xUsableSize - sizeof( size_t ) ) )
+			{
+				xReturn = pdTRUE;
+			}
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapGuardPoison( void *pv, size_t xUsableSize )
+{
+	memset( pv, configHEAP_GUARD_POISON, xUsableSize );
+}
+
+#endif /* configHEAP_USE_GUARDS */
@@ -0,0 +1,211 @@
+/*
+ * FreeRTOS Kernel V10.2.1
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * Low memory callbacks for any of the heap implementations.  Build this file
+ * along with the heap and set configHEAP_USE_RECLAIM to 1.
+ *
+ * The callbacks are kept in a small table that entries are only ever added
+ * to.  Each has a source - the whole heap or one pool - a watermark, and a
+ * flag that is cleared when the callback is called and set again once the
+ * free space of its source is seen back at or above the watermark, so falling
+ * below it calls the callback once however many allocations follow.  Only the
+ * task that sets xReclaiming calls callbacks, and the scheduler is never
+ * suspended while it does, so a callback can free memory, allocate it, or take
+ * a lock of its own.
+ */
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configHEAP_USE_RECLAIM == 1 )
+
+#if( configHEAP_RECLAIM_CALLBACKS < 1 )
+	#error configHEAP_RECLAIM_CALLBACKS must be at least 1
+#endif
+
+typedef struct HeapReclaim
+{
+	size_t xSource;						/* portHEAP_RECLAIM_HEAP or the index of a pool. */
+	size_t xWatermark;					/* Called when the free space of the source falls below this. */
+	HeapReclaimCallback_t pxCallback;
+	void *pvParameter;
+	BaseType_t xArmed;					/* pdFALSE once called, until the free space recovers. */
+} HeapReclaim_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Returns pdTRUE, with xReclaiming set, if no other task was calling
+ * callbacks.
+ */
+static BaseType_t prvStartReclaiming( void );
+
+/*-----------------------------------------------------------*/
+
+static HeapReclaim_t xReclaim[ configHEAP_RECLAIM_CALLBACKS ];
+
+/* The entries of xReclaim[] in use.  Only ever goes up, and an entry is filled
+in before it is counted, so xReclaim[] can be read without a lock. */
+static volatile size_t xReclaimCount = 0;
+
+/* pdTRUE while a task is calling callbacks. */
+static volatile BaseType_t xReclaiming = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortHeapAddReclaimCallback( size_t xWatermark, HeapReclaimCallback_t pxCallback, void *pvParameter )
+{
+	return xPortHeapReclaimAdd( portHEAP_RECLAIM_HEAP, xWatermark, pxCallback, pvParameter );
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortHeapReclaimAdd( size_t xSource, size_t xWatermark, HeapReclaimCallback_t pxCallback, void *pvParameter )
+{
+BaseType_t xReturn = pdFALSE;
+
+	configASSERT( pxCallback != NULL );
+
+	vTaskSuspendAll();
+	{
+		if( xReclaimCount < configHEAP_RECLAIM_CALLBACKS )
+		{
+			xReclaim[ xReclaimCount ].xSource = xSource;
+			xReclaim[ xReclaimCount ].xWatermark = xWatermark;
+			xReclaim[ xReclaimCount ].pxCallback = pxCallback;
+			xReclaim[ xReclaimCount ].pvParameter = pvParameter;
+			xReclaim[ xReclaimCount ].xArmed = pdTRUE;
+			xReclaimCount++;
+			xReturn = pdTRUE;
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapReclaimCheck( size_t xSource, size_t xFree )
+{
+size_t x;
+BaseType_t xBelow = pdFALSE;
+
+	if( xReclaiming == pdFALSE )
+	{
+		/* The common case, with nothing to call, takes no lock.  Setting a
+		flag again while another task clears it at worst calls its callback
+		one more time. */
+		for( x = 0; x < xReclaimCount; x++ )
+		{
+			if( xReclaim[ x ].xSource == xSource )
+			{
+				if( xFree >= xReclaim[ x ].xWatermark )
+				{
+					xReclaim[ x ].xArmed = pdTRUE;
+				}
+				else if( xReclaim[ x ].xArmed != pdFALSE )
+				{
+					xBelow = pdTRUE;
+				}
+			}
+		}
+
+		if( ( xBelow != pdFALSE ) && ( prvStartReclaiming() == pdTRUE ) )
+		{
+			for( x = 0; x < xReclaimCount; x++ )
+			{
+				if( ( xReclaim[ x ].xSource == xSource ) && ( xFree < xReclaim[ x ].xWatermark ) && ( xReclaim[ x ].xArmed != pdFALSE ) )
+				{
+					xReclaim[ x ].xArmed = pdFALSE;
+					xReclaim[ x ].pxCallback( xReclaim[ x ].pvParameter );
+				}
+			}
+
+			xReclaiming = pdFALSE;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortHeapReclaimBegin( size_t xSource )
+{
+size_t x;
+BaseType_t xCalled = pdFALSE;
+
+	if( ( xReclaiming == pdFALSE ) && ( xReclaimCount > 0 ) && ( prvStartReclaiming() == pdTRUE ) )
+	{
+		for( x = 0; x < xReclaimCount; x++ )
+		{
+			if( ( xReclaim[ x ].xSource == portHEAP_RECLAIM_HEAP ) || ( xReclaim[ x ].xSource == xSource ) )
+			{
+				xReclaim[ x ].xArmed = pdFALSE;
+				xReclaim[ x ].pxCallback( xReclaim[ x ].pvParameter );
+				xCalled = pdTRUE;
+			}
+		}
+
+		if( xCalled == pdFALSE )
+		{
+			xReclaiming = pdFALSE;
+		}
+	}
+
+	return xCalled;
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapReclaimEnd( void )
+{
+	xReclaiming = pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+static BaseType_t prvStartReclaiming( void )
+{
+BaseType_t xReturn = pdFALSE;
+
+	vTaskSuspendAll();
+	{
+		if( xReclaiming == pdFALSE )
+		{
+			xReclaiming = pdTRUE;
+			xReturn = pdTRUE;
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	return xReturn;
+}
+
+#endif /* configHEAP_USE_RECLAIM */
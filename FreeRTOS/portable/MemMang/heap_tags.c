@@ -0,0 +1,346 @@
+/*
+ * FreeRTOS Kernel V10.2.1
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * Records which task, and which caller supplied tag, owns each live heap
+ * block, for use with any of the heap implementations.  Build this file along
+ * with the heap and set configHEAP_USE_ALLOCATION_TAGS to 1.
+ *
+ * The records are kept in a fixed size open addressed hash table keyed on the
+ * block's address, so no block header grows and nothing here allocates.  Each
+ * record holds the bytes the block takes from the heap, header and rounding
+ * included, as the heap reports them through portHEAP_TAG_RECORD().  Blocks are
+ * owned by the task that allocated them, or by no task (NULL) if they were
+ * allocated before the scheduler started or from an interrupt, and start with
+ * a tag of 0.  A block that pvPortRealloc() has to move starts over as a new
+ * allocation.
+ *
+ * If the table is full an allocation is simply not recorded, and is counted by
+ * xPortGetHeapTagMisses().  Every table operation is a short critical section.
+ * The sums walk the whole table, so take configHEAP_TAG_TABLE_SIZE steps with
+ * interrupts masked.
+ */
+#include <stdlib.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configHEAP_USE_ALLOCATION_TAGS == 1 )
+
+#if( INCLUDE_xTaskGetCurrentTaskHandle != 1 ) || ( ( INCLUDE_xTaskGetSchedulerState != 1 ) && ( configUSE_TIMERS != 1 ) )
+	#error configHEAP_USE_ALLOCATION_TAGS requires INCLUDE_xTaskGetCurrentTaskHandle and INCLUDE_xTaskGetSchedulerState to be 1
+#endif
+
+/* The number of live blocks that can be recorded.  Must be a power of two. */
+#ifndef configHEAP_TAG_TABLE_SIZE
+	#define configHEAP_TAG_TABLE_SIZE	128
+#endif
+
+#if( ( configHEAP_TAG_TABLE_SIZE & ( configHEAP_TAG_TABLE_SIZE - 1 ) ) != 0 ) || ( configHEAP_TAG_TABLE_SIZE < 2 )
+	#error configHEAP_TAG_TABLE_SIZE must be a power of two
+#endif
+
+#define heapTAG_INDEX_MASK	( ( size_t ) configHEAP_TAG_TABLE_SIZE - 1 )
+
+/* Spread block addresses, which are all multiples of portBYTE_ALIGNMENT and
+often of a pool stride, over the whole table. */
+#define heapTAG_HASH( pv )	( ( size_t ) ( ( ( uint32_t ) ( ( ( size_t ) ( pv ) ) / portBYTE_ALIGNMENT ) * 0x9E3779B1UL ) >> 7 ) & heapTAG_INDEX_MASK )
+
+/* The record of one live block.  pvBlock is NULL in an empty slot. */
+typedef struct TagRecord
+{
+	void *pvBlock;			/* The pointer handed to the application. */
+	TaskHandle_t xOwner;	/* The task that allocated it. */
+	uint32_t ulTag;			/* Set by pvPortMallocTagged() or vPortHeapTagSet(). */
+	size_t xSize;			/* The bytes it takes from the heap. */
+} TagRecord_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Return the slot that holds pv, or the empty slot where it would go, or
+ * configHEAP_TAG_TABLE_SIZE if pv is not recorded and the table is full.  Must
+ * be called in a critical section.
+ */
+static size_t prvFindRecord( const void *pv );
+
+/*
+ * Add, or empty the slot of, the record of pv.  Must be called in a critical
+ * section.
+ */
+static void prvInsertRecord( void *pv, size_t xSize, TaskHandle_t xOwner );
+static void prvRemoveRecord( const void *pv );
+
+/*-----------------------------------------------------------*/
+
+static TagRecord_t xTagTable[ configHEAP_TAG_TABLE_SIZE ];
+
+/* The number of records in the table, and the number of allocations that
+could not be recorded because it was full.  One slot is always left empty so
+every probe sequence ends. */
+static size_t xTagRecords = 0;
+static size_t xTagMisses = 0;
+
+/*-----------------------------------------------------------*/
+
+void *pvPortMallocTagged( size_t xWantedSize, uint32_t ulTag )
+{
+void *pvReturn;
+
+	pvReturn = pvPortMalloc( xWantedSize );
+	vPortHeapTagSet( pvReturn, ulTag );
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapTagSet( void *pv, uint32_t ulTag )
+{
+size_t x;
+
+	if( pv != NULL )
+	{
+		taskENTER_CRITICAL();
+		{
+			x = prvFindRecord( pv );
+			if( ( x < configHEAP_TAG_TABLE_SIZE ) && ( xTagTable[ x ].pvBlock == pv ) )
+			{
+				xTagTable[ x ].ulTag = ulTag;
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetTaskHeapUsage( struct tskTaskControlBlock *xTask )
+{
+size_t x, xBytes = 0;
+
+	taskENTER_CRITICAL();
+	{
+		for( x = 0; x < configHEAP_TAG_TABLE_SIZE; x++ )
+		{
+			if( ( xTagTable[ x ].pvBlock != NULL ) && ( xTagTable[ x ].xOwner == xTask ) )
+			{
+				xBytes += xTagTable[ x ].xSize;
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return xBytes;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetTagHeapUsage( uint32_t ulTag )
+{
+size_t x, xBytes = 0;
+
+	taskENTER_CRITICAL();
+	{
+		for( x = 0; x < configHEAP_TAG_TABLE_SIZE; x++ )
+		{
+			if( ( xTagTable[ x ].pvBlock != NULL ) && ( xTagTable[ x ].ulTag == ulTag ) )
+			{
+				xBytes += xTagTable[ x ].xSize;
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return xBytes;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetHeapTagMisses( void )
+{
+	return xTagMisses;
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapTagRecord( void *pv, size_t xSize )
+{
+TaskHandle_t xOwner = NULL;
+
+	if( pv != NULL )
+	{
+		if( xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED )
+		{
+			xOwner = xTaskGetCurrentTaskHandle();
+		}
+
+		taskENTER_CRITICAL();
+		{
+			prvInsertRecord( pv, xSize, xOwner );
+		}
+		taskEXIT_CRITICAL();
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapTagRecordFromISR( void *pv, size_t xSize )
+{
+UBaseType_t uxSavedInterruptStatus;
+
+	if( pv != NULL )
+	{
+		uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+		{
+			prvInsertRecord( pv, xSize, NULL );
+		}
+		taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapTagResize( void *pv, size_t xSize )
+{
+size_t x;
+
+	taskENTER_CRITICAL();
+	{
+		x = prvFindRecord( pv );
+		if( ( x < configHEAP_TAG_TABLE_SIZE ) && ( xTagTable[ x ].pvBlock == pv ) )
+		{
+			xTagTable[ x ].xSize = xSize;
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapTagForget( void *pv )
+{
+	taskENTER_CRITICAL();
+	{
+		prvRemoveRecord( pv );
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapTagForgetFromISR( void *pv )
+{
+UBaseType_t uxSavedInterruptStatus;
+
+	uxSavedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+	{
+		prvRemoveRecord( pv );
+	}
+	taskEXIT_CRITICAL_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvFindRecord( const void *pv )
+{
+size_t x = heapTAG_HASH( pv ), xProbes;
+
+	/* Linear probing - a record is never further from its home slot than the
+	first empty slot after it. */
+	for( xProbes = 0; xProbes < configHEAP_TAG_TABLE_SIZE; xProbes++ )
+	{
+		if( ( xTagTable[ x ].pvBlock == pv ) || ( xTagTable[ x ].pvBlock == NULL ) )
+		{
+			return x;
+		}
+
+		x = ( x + 1 ) & heapTAG_INDEX_MASK;
+	}
+
+	return configHEAP_TAG_TABLE_SIZE;
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertRecord( void *pv, size_t xSize, TaskHandle_t xOwner )
+{
+size_t x = prvFindRecord( pv );
+
+	if( ( x < configHEAP_TAG_TABLE_SIZE ) && ( ( xTagTable[ x ].pvBlock == pv ) || ( xTagRecords < heapTAG_INDEX_MASK ) ) )
+	{
+		/* A record left behind for a block that was freed without passing
+		through the hooks is simply replaced. */
+		if( xTagTable[ x ].pvBlock == NULL )
+		{
+			xTagRecords++;
+		}
+
+		xTagTable[ x ].pvBlock = pv;
+		xTagTable[ x ].xOwner = xOwner;
+		xTagTable[ x ].ulTag = 0;
+		xTagTable[ x ].xSize = xSize;
+	}
+	else
+	{
+		xTagMisses++;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveRecord( const void *pv )
+{
+size_t x, xNext, xHome;
+
+	if( pv == NULL )
+	{
+		return;
+	}
+
+	x = prvFindRecord( pv );
+	if( ( x == configHEAP_TAG_TABLE_SIZE ) || ( xTagTable[ x ].pvBlock != pv ) )
+	{
+		/* The block was never recorded. */
+		return;
+	}
+
+	/* Close the gap by moving back any later record of the same run that
+	could not be placed at or before the slot being emptied, so no search
+	stops short at it. */
+	for( xNext = ( x + 1 ) & heapTAG_INDEX_MASK; xTagTable[ xNext ].pvBlock != NULL; xNext = ( xNext + 1 ) & heapTAG_INDEX_MASK )
+	{
+		xHome = heapTAG_HASH( xTagTable[ xNext ].pvBlock );
+
+		/* Is xHome cyclically outside ( x, xNext ]? */
+		if( ( ( xNext - xHome ) & heapTAG_INDEX_MASK ) >= ( ( xNext - x ) & heapTAG_INDEX_MASK ) )
+		{
+			xTagTable[ x ] = xTagTable[ xNext ];
+			x = xNext;
+		}
+	}
+
+	xTagTable[ x ].pvBlock = NULL;
+	xTagRecords--;
+}
+
+#endif /* configHEAP_USE_ALLOCATION_TAGS */
@@ -0,0 +1,167 @@
+/*
+ * FreeRTOS Kernel V10.2.1
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * Times the sections the heap implementations run with the scheduler
+ * suspended, for use with any of them.  Build this file along with the heap
+ * and set configHEAP_USE_TIMING to 1.
+ *
+ * While the scheduler is suspended no other task can enter a heap section, so
+ * each section needs only one start time and the figures can be updated
+ * without a critical section.  The heaps never time anything they do from an
+ * interrupt.  Recording a section takes a constant handful of cycles, so it
+ * can stay enabled in the build that is measured for the worst case.
+ */
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configHEAP_USE_TIMING == 1 )
+
+#if( configHEAP_TIMING_BUCKETS < 1 ) || ( configHEAP_TIMING_BUCKETS > 32 )
+	#error configHEAP_TIMING_BUCKETS must be between 1 and 32
+#endif
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Returns the index of the highest bit set in ulValue, or 0 if none is.
+ */
+static UBaseType_t prvFindLastSet( uint32_t ulValue );
+
+/*-----------------------------------------------------------*/
+
+static HeapTimingStats_t xTimingStats[ portHEAP_TIMING_SECTIONS ];
+
+/* The cycle count when each section last started. */
+static uint32_t ulSectionStart[ portHEAP_TIMING_SECTIONS ];
+
+/*-----------------------------------------------------------*/
+
+void vPortHeapTimingStart( UBaseType_t uxSection )
+{
+	ulSectionStart[ uxSection ] = configHEAP_CYCLE_COUNT();
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapTimingStop( UBaseType_t uxSection )
+{
+uint32_t ulCycles = configHEAP_CYCLE_COUNT();
+HeapTimingStats_t *pxStats;
+UBaseType_t uxBucket;
+
+	/* Unsigned arithmetic copes with the counter wrapping. */
+	ulCycles -= ulSectionStart[ uxSection ];
+	pxStats = &( xTimingStats[ uxSection ] );
+
+	if( ( pxStats->ulCount == 0 ) || ( ulCycles < pxStats->ulMinimumCycles ) )
+	{
+		pxStats->ulMinimumCycles = ulCycles;
+	}
+
+	if( ulCycles > pxStats->ulMaximumCycles )
+	{
+		pxStats->ulMaximumCycles = ulCycles;
+	}
+
+	uxBucket = prvFindLastSet( ulCycles );
+	if( uxBucket >= ( UBaseType_t ) configHEAP_TIMING_BUCKETS )
+	{
+		uxBucket = ( UBaseType_t ) configHEAP_TIMING_BUCKETS - 1;
+	}
+
+	pxStats->ulHistogram[ uxBucket ]++;
+	pxStats->ulCount++;
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapTimingStats( HeapTimingStats_t *pxStats, size_t xStatsLength )
+{
+size_t x;
+
+	if( xStatsLength > portHEAP_TIMING_SECTIONS )
+	{
+		xStatsLength = portHEAP_TIMING_SECTIONS;
+	}
+
+	/* Suspending the scheduler keeps every section out, as they run with it
+	suspended. */
+	vTaskSuspendAll();
+	{
+		for( x = 0; x < xStatsLength; x++ )
+		{
+			pxStats[ x ] = xTimingStats[ x ];
+		}
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+void vPortResetHeapTimingStats( void )
+{
+size_t x, xBucket;
+
+	vTaskSuspendAll();
+	{
+		for( x = 0; x < portHEAP_TIMING_SECTIONS; x++ )
+		{
+			xTimingStats[ x ].ulCount = 0;
+			xTimingStats[ x ].ulMinimumCycles = 0;
+			xTimingStats[ x ].ulMaximumCycles = 0;
+
+			for( xBucket = 0; xBucket < configHEAP_TIMING_BUCKETS; xBucket++ )
+			{
+				xTimingStats[ x ].ulHistogram[ xBucket ] = 0;
+			}
+		}
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFindLastSet( uint32_t ulValue )
+{
+UBaseType_t uxBit = 0;
+
+	/* A binary search, so the time taken does not depend on the value. */
+	if( ( ulValue & 0xFFFF0000UL ) != 0 ) { ulValue >>= 16; uxBit += 16; }
+	if( ( ulValue & 0x0000FF00UL ) != 0 ) { ulValue >>= 8; uxBit += 8; }
+	if( ( ulValue & 0x000000F0UL ) != 0 ) { ulValue >>= 4; uxBit += 4; }
+	if( ( ulValue & 0x0000000CUL ) != 0 ) { ulValue >>= 2; uxBit += 2; }
+	if( ( ulValue & 0x00000002UL ) != 0 ) { uxBit += 1; }
+
+	return uxBit;
+}
+
+#endif /* configHEAP_USE_TIMING */
@@ -0,0 +1,221 @@
+/*
+ * FreeRTOS Kernel V10.2.1
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * Records every heap operation into a ring buffer in RAM, for use with any of
+ * the heap implementations.  Build this file along with the heap and set
+ * configHEAP_USE_TRACE to 1.
+ *
+ * Each record holds the operation, the size requested, the pointer, the task
+ * and a timestamp, configHEAP_TRACE_TIMESTAMP(), which by default reads the
+ * cycle counter, configHEAP_CYCLE_COUNT().  Recording one takes a call, a read
+ * of the current task handle, a short interrupt masked section and five
+ * stores, so it is cheap enough to leave enabled in production builds.  Nothing is ever
+ * formatted or sent anywhere on the target - the buffer is xHeapTrace, which
+ * a debugger or DMA channel reads out as it is, and heap_trace_decode.py turns
+ * a copy of it into a trace that host/heap_bench.c can replay.
+ *
+ * xHeapTrace is laid out as six uint32_t words, the magic number "HTRC", the
+ * format version, sizeof( HeapTraceRecord_t ), configHEAP_TRACE_BUFFER_SIZE,
+ * the number of records ever written and a flag that is non zero while
+ * recording is stopped, followed by the records.  The header is filled in by
+ * the first record, so until then the whole buffer is zero and sits in .bss
+ * rather than taking space in the image.
+ */
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configHEAP_USE_TRACE == 1 )
+
+#if( INCLUDE_xTaskGetCurrentTaskHandle != 1 )
+	#error configHEAP_USE_TRACE requires INCLUDE_xTaskGetCurrentTaskHandle to be 1
+#endif
+
+/* The number of records kept.  Must be a power of two. */
+#ifndef configHEAP_TRACE_BUFFER_SIZE
+	#define configHEAP_TRACE_BUFFER_SIZE	256
+#endif
+
+#if( ( configHEAP_TRACE_BUFFER_SIZE & ( configHEAP_TRACE_BUFFER_SIZE - 1 ) ) != 0 ) || ( configHEAP_TRACE_BUFFER_SIZE < 2 )
+	#error configHEAP_TRACE_BUFFER_SIZE must be a power of two
+#endif
+
+/* A free running 32-bit counter, by default the cycle counter. */
+#ifndef configHEAP_TRACE_TIMESTAMP
+	#define configHEAP_TRACE_TIMESTAMP()	configHEAP_CYCLE_COUNT()
+#endif
+
+#define heapTRACE_MAGIC			( ( uint32_t ) 0x48545243UL )	/* "HTRC" */
+#define heapTRACE_VERSION		( ( uint32_t ) 1 )
+#define heapTRACE_INDEX_MASK	( ( uint32_t ) configHEAP_TRACE_BUFFER_SIZE - 1 )
+#define heapTRACE_SIZE_MASK		( ~portHEAP_TRACE_OP_MASK )
+
+typedef struct HeapTrace
+{
+	uint32_t ulMagic;
+	uint32_t ulVersion;
+	uint32_t ulRecordSize;
+	uint32_t ulRecordCount;
+	volatile uint32_t ulHead;		/* The number of records ever written, so the next goes at ulHead & heapTRACE_INDEX_MASK. */
+	volatile uint32_t ulStopped;
+	HeapTraceRecord_t xRecords[ configHEAP_TRACE_BUFFER_SIZE ];
+} HeapTrace_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Add one record.  Safe from both tasks and interrupts.
+ */
+static void prvRecord( uint32_t ulOp, void *pv, size_t xSize, TaskHandle_t xTask );
+
+/*
+ * Fill in the header of xHeapTrace.  Must be called with interrupts masked.
+ */
+static void prvInitialise( void );
+
+/*-----------------------------------------------------------*/
+
+/* Not static, so a debugger can find it by name. */
+HeapTrace_t xHeapTrace;
+
+/*-----------------------------------------------------------*/
+
+void vPortHeapTraceEnable( BaseType_t xEnable )
+{
+UBaseType_t uxSavedInterruptStatus;
+
+	uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+	{
+		prvInitialise();
+		xHeapTrace.ulStopped = ( xEnable == pdFALSE ) ? 1U : 0U;
+	}
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortHeapTraceRead( HeapTraceRecord_t *pxRecords, size_t xMaxRecords, uint32_t *pulNextRecord )
+{
+size_t xRead = 0;
+BaseType_t xMore = pdTRUE;
+UBaseType_t uxSavedInterruptStatus;
+
+	configASSERT( pulNextRecord );
+
+	/* One record at a time, so interrupts are never masked for long. */
+	while( ( xRead < xMaxRecords ) && ( xMore == pdTRUE ) )
+	{
+		uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+		{
+			if( ( xHeapTrace.ulHead - *pulNextRecord ) > configHEAP_TRACE_BUFFER_SIZE )
+			{
+				/* The records the reader wanted have been overwritten. */
+				*pulNextRecord = xHeapTrace.ulHead - configHEAP_TRACE_BUFFER_SIZE;
+			}
+
+			if( *pulNextRecord != xHeapTrace.ulHead )
+			{
+				pxRecords[ xRead ] = xHeapTrace.xRecords[ *pulNextRecord & heapTRACE_INDEX_MASK ];
+				( *pulNextRecord )++;
+				xRead++;
+			}
+			else
+			{
+				xMore = pdFALSE;
+			}
+		}
+		portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+	}
+
+	return xRead;
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapTraceRecord( uint32_t ulOp, void *pv, size_t xSize )
+{
+	prvRecord( ulOp, pv, xSize, xTaskGetCurrentTaskHandle() );
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapTraceRecordFromISR( uint32_t ulOp, void *pv, size_t xSize )
+{
+	prvRecord( ulOp, pv, xSize, NULL );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRecord( uint32_t ulOp, void *pv, size_t xSize, TaskHandle_t xTask )
+{
+HeapTraceRecord_t *pxRecord;
+UBaseType_t uxSavedInterruptStatus;
+
+	if( xSize > heapTRACE_SIZE_MASK )
+	{
+		xSize = heapTRACE_SIZE_MASK;
+	}
+
+	/* The interrupt mask is saved and restored rather than using
+	taskENTER_CRITICAL(), both because it is cheaper and because the heaps
+	call this from inside their own critical sections and from interrupts. */
+	uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+	{
+		if( xHeapTrace.ulMagic != heapTRACE_MAGIC )
+		{
+			prvInitialise();
+		}
+
+		if( xHeapTrace.ulStopped == 0U )
+		{
+			pxRecord = &( xHeapTrace.xRecords[ xHeapTrace.ulHead & heapTRACE_INDEX_MASK ] );
+			pxRecord->ulTimestamp = configHEAP_TRACE_TIMESTAMP();
+			pxRecord->ulOpAndSize = ulOp | ( uint32_t ) xSize;
+			pxRecord->pvBlock = pv;
+			pxRecord->xTask = xTask;
+			xHeapTrace.ulHead++;
+		}
+	}
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
+}
+/*-----------------------------------------------------------*/
+
+static void prvInitialise( void )
+{
+	if( xHeapTrace.ulMagic != heapTRACE_MAGIC )
+	{
+		xHeapTrace.ulVersion = heapTRACE_VERSION;
+		xHeapTrace.ulRecordSize = ( uint32_t ) sizeof( HeapTraceRecord_t );
+		xHeapTrace.ulRecordCount = ( uint32_t ) configHEAP_TRACE_BUFFER_SIZE;
+		xHeapTrace.ulMagic = heapTRACE_MAGIC;
+	}
+}
+
+#endif /* configHEAP_USE_TRACE */
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+#
+# Decoder for the allocation trace that heap_trace.c records into xHeapTrace.
+#
+# The input is a copy of xHeapTrace, as dumped by a debugger or sent by DMA,
+# in the byte order of the target:
+#
+#   magic ("HTRC"), version, record size, record count, records written,
+#   stopped flag
+#   then for each record:   timestamp, operation and size, pointer, task
+#
+# The first two fields of a record are 32-bit words, the pointers take the
+# rest of the record size between them.  The oldest record is the one after
+# the last written, unless fewer than record count have ever been written.
+#
+# By default the records are written out oldest first as a trace for
+# host/heap_bench.c, "m <pointer> <size>" for each allocation and
+# "f <pointer>" for each free, with a block resized in place given as a free
+# then an allocation of the same pointer.  --raw lists every record instead,
+# with its timestamp and task.
+#
+# Usage: heap_trace_decode.py <trace.bin> [--raw]
+
+import struct
+import sys
+
+MAGIC = 0x48545243
+VERSIONS = (1,)
+HEADER_WORDS = 6
+
+OP_MALLOC = 0
+OP_FREE = 1
+OP_REALLOC = 2
+OP_NAMES = {OP_MALLOC: "malloc", OP_FREE: "free", OP_REALLOC: "realloc"}
+SIZE_MASK = 0x3FFFFFFF
+
+
+class TraceError(Exception):
+    pass
+
+
+def decode(data):
+    """Returns the header of the trace in data as a dictionary, and its
+    records, oldest first, as a list of (timestamp, op, size, block, task)."""
+    if len(data) < HEADER_WORDS * 4:
+        raise TraceError("trace is shorter than its header")
+
+    # The magic number gives the byte order of the target.
+    for order in ("<", ">"):
+        if struct.unpack_from(order + "I", data, 0)[0] == MAGIC:
+            break
+    else:
+        raise TraceError("bad magic number, or no record was ever written")
+
+    header = struct.unpack_from("%s%dI" % (order, HEADER_WORDS), data, 0)
+    if header[1] not in VERSIONS:
+        raise TraceError("unsupported version %d" % header[1])
+
+    record_size, record_count, written = header[2], header[3], header[4]
+    pointer_size = (record_size - 8) // 2
+    if pointer_size not in (4, 8) or record_size != 8 + 2 * pointer_size:
+        raise TraceError("unexpected record size %d" % record_size)
+    if len(data) < HEADER_WORDS * 4 + record_count * record_size:
+        raise TraceError("trace is shorter than its records")
+
+    record_format = order + "II" + ("I" if pointer_size == 4 else "Q") * 2
+    records = []
+    first = written - record_count if written > record_count else 0
+    for n in range(first, written):
+        offset = HEADER_WORDS * 4 + (n % record_count) * record_size
+        timestamp, op_and_size, block, task = struct.unpack_from(record_format, data, offset)
+        records.append((timestamp, op_and_size >> 30, op_and_size & SIZE_MASK, block, task))
+
+    trace = {
+        "big_endian": order == ">",
+        "pointer_size": pointer_size,
+        "record_count": record_count,
+        "written": written,
+        "stopped": header[5] != 0,
+    }
+
+    return trace, records
+
+
+def write_replay(trace, records, out):
+    out.write("# %d of %d records\n" % (len(records), trace["written"]))
+    for _, op, size, block, _ in records:
+        if op == OP_MALLOC:
+            if block != 0:
+                out.write("m 0x%x %d\n" % (block, size))
+            else:
+                out.write("# failed m %d\n" % size)
+        elif op == OP_FREE:
+            out.write("f 0x%x\n" % block)
+        elif op == OP_REALLOC:
+            out.write("f 0x%x\nm 0x%x %d\n" % (block, block, size))
+
+
+def write_raw(trace, records, out):
+    out.write("%d of %d records%s\n\n" % (len(records), trace["written"],
+                                          ", recording stopped" if trace["stopped"] else ""))
+    out.write("timestamp   delta       op       size  pointer  task\n")
+    pointer = "0x%%0%dx" % (trace["pointer_size"] * 2)
+    previous = records[0][0] if records else 0
+    for timestamp, op, size, block, task in records:
+        out.write("%10u  %10u  %-7s  %10d  %s  %s\n" % (
+            timestamp, (timestamp - previous) & 0xFFFFFFFF, OP_NAMES.get(op, "?"),
+            size, pointer % block, "none" if task == 0 else "0x%x" % task))
+        previous = timestamp
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write("usage: %s <trace.bin> [--raw]\n" % argv[0])
+        return 2
+
+    with open(argv[1], "rb") as f:
+        data = f.read()
+
+    try:
+        trace, records = decode(data)
+    except TraceError as e:
+        sys.stderr.write("%s: %s\n" % (argv[1], e))
+        return 1
+
+    if "--raw" in argv[2:]:
+        write_raw(trace, records, sys.stdout)
+    else:
+        write_replay(trace, records, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,29 @@
+/*
+ * A cut down FreeRTOS.h for building the heap implementations on the host,
+ * see heap_bench.c.  It provides only what the heaps use.
+ */
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOSConfig.h"
+
+#define pdFALSE			( ( BaseType_t ) 0 )
+#define pdTRUE			( ( BaseType_t ) 1 )
+#define pdPASS			( pdTRUE )
+#define pdFAIL			( pdFALSE )
+
+#define mtCOVERAGE_TEST_MARKER()
+
+typedef void ( *TaskFunction_t )( void * );
+
+#include "portable.h"
+
+/* vPrintFreeList() in heap_777.c writes to a UART through the ST HAL. */
+typedef struct { int iUnused; } UART_HandleTypeDef;
+extern UART_HandleTypeDef huart2;
+int HAL_UART_Transmit( UART_HandleTypeDef *pxHandle, uint8_t *pucData, uint16_t usSize, uint32_t ulTimeout );
+
+#endif /* INC_FREERTOS_H */
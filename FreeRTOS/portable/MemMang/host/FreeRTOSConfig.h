@@ -0,0 +1,33 @@
+/*
+ * Configuration for the host build of the heap benchmark, see heap_bench.c.
+ * Everything can be overridden from the compiler command line.
+ */
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#ifndef configTOTAL_HEAP_SIZE
+	#define configTOTAL_HEAP_SIZE			( 64 * 1024 )
+#endif
+
+#ifndef configUSE_MALLOC_FAILED_HOOK
+	#define configUSE_MALLOC_FAILED_HOOK	0
+#endif
+
+#define configSUPPORT_DYNAMIC_ALLOCATION	1
+#define configAPPLICATION_ALLOCATED_HEAP	0
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS	1
+
+/* heap_bench.c provides both, as heap_trace.c and heap_tags.c need them. */
+#define INCLUDE_xTaskGetCurrentTaskHandle	1
+#define INCLUDE_xTaskGetSchedulerState		1
+
+/* The benchmark's own timer stands in for the cycle counter heap_trace.c and
+heap_timing.c read. */
+extern uint32_t ulBenchCycleCount( void );
+#define configHEAP_CYCLE_COUNT()	ulBenchCycleCount()
+
+/* Abort the benchmark rather than carry on with a corrupt heap. */
+extern void vBenchAssertFailed( const char *pcFile, int iLine );
+#define configASSERT( x )	if( ( x ) == 0 ) vBenchAssertFailed( __FILE__, __LINE__ )
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1 @@
+/* Nothing is deprecated in the host build of the heap benchmark. */
@@ -0,0 +1,775 @@
+/*
+ * Host benchmark for the heap implementations.
+ *
+ * heap_2.c, heap_4.c, heap_6.c and heap_777.c are each built in their own
+ * wrapper file with their public names prefixed, so all of them are linked
+ * into one program, over their usual static ucHeap array, and fed exactly the
+ * same sequence of allocations and frees.  The scheduler calls are stubbed out
+ * below.  Build from this directory with:
+ *
+ *   gcc -O2 -I. -I../../../include heap_bench.c heap_bench_heap_2.c \
+ *       heap_bench_heap_4.c heap_bench_heap_6.c heap_bench_heap_777.c \
+ *       ../heap_guard.c ../heap_trace.c ../heap_tags.c ../heap_timing.c \
+ *       ../heap_reclaim.c -o heap_bench
+ *
+ * Add -DconfigTOTAL_HEAP_SIZE=<bytes> to change the size of every heap, and
+ * any of the heap_4.c or heap_777.c options, such as
+ * -DconfigHEAP_FIT_POLICY=2 or -DconfigHEAP_USE_SPANS=1, to compare them.
+ * The helper files on the second line are empty unless an option such as
+ * -DconfigHEAP_USE_TRACE=1 or -DconfigHEAP_USE_GUARDS=1 needs them, and are
+ * shared by every heap that uses them.
+ * With -DconfigHEAP_USE_TASK_CACHE=1 the run is made through a task cache,
+ * and with -DconfigHEAP_USE_REGIONS=1 heap_777.c is given its heap as two
+ * regions.
+ *
+ * The operations either come from a trace file, or are generated:
+ *
+ *   heap_bench --trace <file>
+ *   heap_bench [--dist small|uniform|mixed] [--ops <n>] [--live <n>] [--seed <n>]
+ *
+ * A trace has one operation per line, "m <key> <size>" to allocate and
+ * "f <key>" to free, where a key is any decimal or 0x prefixed number naming
+ * the block - the address the target returned will do.  Lines starting with
+ * '#' are ignored.  Frees of keys that were never allocated are skipped.
+ * Generated runs keep about --live blocks allocated, freeing a random one of
+ * them as often as they allocate once that many are live.
+ *
+ * --heaps heap_2,heap_4,... picks the heaps to run, and --pools 16,32,64,...
+ * replaces the heap_777.c xSizeList classes.
+ *
+ * Before the run the heaps that have pvPortMallocAligned() are checked to
+ * give a large aligned block on a fresh heap.
+ *
+ * For each heap the cost of every call is timed, in cycles from the time
+ * stamp counter on x86 and in nanoseconds elsewhere, less the cost of reading
+ * the timer.  It then reports the median, 99th percentile and worst case of
+ * each, the most heap ever in use against the bytes actually requested at the
+ * time, where the first allocation failed, and once the run is over the
+ * largest block that can still be allocated, from which external fragmentation
+ * is given as the share of the free space not in reach of one allocation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+	#include <x86intrin.h>
+	#define benchTIMER_UNIT		"cycles"
+#else
+	#include <time.h>
+	#define benchTIMER_UNIT		"ns"
+#endif
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "heap_bench.h"
+
+/* The size classes generated runs draw from. */
+#define benchDIST_SMALL		0	/* 90% up to 128 bytes, the rest up to 1KB. */
+#define benchDIST_UNIFORM	1	/* Evenly spread up to 1KB. */
+#define benchDIST_MIXED		2	/* 70% up to 128 bytes, 25% up to 1KB, 5% up to 8KB. */
+
+#define benchMAX_POOLS		32
+
+/* One operation of the run.  Blocks are numbered in the order they are
+allocated, so every heap can keep its pointers in a plain array. */
+typedef struct BenchOp
+{
+	size_t xBlock;
+	size_t xSize;		/* 0 for a free. */
+} BenchOp_t;
+
+typedef struct BenchRun
+{
+	BenchOp_t *pxOps;
+	size_t xOps;
+	size_t xBlocks;
+} BenchRun_t;
+
+/* What was measured for one heap. */
+typedef struct BenchResult
+{
+	uint64_t *pullMallocTimes;
+	uint64_t *pullFreeTimes;
+	size_t xMallocs;
+	size_t xFrees;
+	size_t xBaseFree;			/* Free bytes before the run. */
+	size_t xPeakInUse;			/* The most heap in use, headers and all. */
+	size_t xLiveAtPeak;			/* The bytes requested by the blocks live at that point. */
+	size_t xFailures;
+	size_t xFirstFailure;		/* The operation that first failed. */
+	size_t xFirstFailureSize;	/* Its size. */
+	size_t xFreeAtFirstFailure;	/* And the free bytes reported when it did. */
+	size_t xFreeAtEnd;
+	size_t xLargestAtEnd;
+} BenchResult_t;
+
+static const HeapBenchAllocator_t * const pxAllAllocators[] = { &xBenchHeap2, &xBenchHeap4, &xBenchHeap6, &xBenchHeap777 };
+
+/* Set up from the command line. */
+static size_t xPoolSizes[ benchMAX_POOLS ];
+static size_t xPoolCount = 0;
+
+/* The cost of reading the timer twice, taken off every measurement. */
+static uint64_t ullTimerOverhead = 0;
+
+/* The heap prvRun() is running. */
+static const HeapBenchAllocator_t *pxRunningHeap = NULL;
+
+/*-----------------------------------------------------------*/
+
+/* The scheduler, as far as the heaps can tell. */
+
+static BaseType_t xSuspended = 0;
+
+void vTaskSuspendAll( void )
+{
+	xSuspended++;
+}
+
+BaseType_t xTaskResumeAll( void )
+{
+	configASSERT( xSuspended > 0 );
+	xSuspended--;
+	return pdFALSE;
+}
+
+BaseType_t xTaskGetSchedulerState( void )
+{
+	return ( xSuspended > 0 ) ? taskSCHEDULER_SUSPENDED : taskSCHEDULER_RUNNING;
+}
+
+/* The one task the benchmark runs in, which has thread local storage so that
+heap_777.c can keep a task cache in it. */
+typedef struct BenchTask
+{
+	void *pvThreadLocalStorage[ configNUM_THREAD_LOCAL_STORAGE_POINTERS ];
+} BenchTask_t;
+
+static BenchTask_t xBenchTask;
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+	return &xBenchTask;
+}
+
+void *pvTaskGetThreadLocalStoragePointer( TaskHandle_t xTaskToQuery, BaseType_t xIndex )
+{
+BenchTask_t *pxTask = ( xTaskToQuery != NULL ) ? xTaskToQuery : &xBenchTask;
+
+	configASSERT( ( xIndex >= 0 ) && ( xIndex < configNUM_THREAD_LOCAL_STORAGE_POINTERS ) );
+	return pxTask->pvThreadLocalStorage[ xIndex ];
+}
+
+void vTaskSetThreadLocalStoragePointer( TaskHandle_t xTaskToSet, BaseType_t xIndex, void *pvValue )
+{
+BenchTask_t *pxTask = ( xTaskToSet != NULL ) ? xTaskToSet : &xBenchTask;
+
+	configASSERT( ( xIndex >= 0 ) && ( xIndex < configNUM_THREAD_LOCAL_STORAGE_POINTERS ) );
+	pxTask->pvThreadLocalStorage[ xIndex ] = pvValue;
+}
+
+/* heap_tags.c calls pvPortMalloc() by its own name, which the wrappers have
+renamed, so it goes to the heap being run. */
+void *pvPortMalloc( size_t xWantedSize )
+{
+	configASSERT( pxRunningHeap != NULL );
+	return pxRunningHeap->pvMalloc( xWantedSize );
+}
+
+UART_HandleTypeDef huart2;
+
+int HAL_UART_Transmit( UART_HandleTypeDef *pxHandle, uint8_t *pucData, uint16_t usSize, uint32_t ulTimeout )
+{
+	( void ) pxHandle;
+	( void ) ulTimeout;
+	return ( int ) fwrite( pucData, 1, usSize, stdout );
+}
+
+void vBenchAssertFailed( const char *pcFile, int iLine )
+{
+	fprintf( stderr, "assertion failed at %s:%d\n", pcFile, iLine );
+	abort();
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvReadTimer( void )
+{
+	#if defined( __x86_64__ ) || defined( __i386__ )
+	{
+		return __rdtsc();
+	}
+	#else
+	{
+	struct timespec xNow;
+
+		clock_gettime( CLOCK_MONOTONIC, &xNow );
+		return ( ( uint64_t ) xNow.tv_sec * 1000000000ULL ) + ( uint64_t ) xNow.tv_nsec;
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulBenchCycleCount( void )
+{
+	return ( uint32_t ) prvReadTimer();
+}
+/*-----------------------------------------------------------*/
+
+static void prvCalibrateTimer( void )
+{
+uint64_t ullStart, ullTime;
+
+	ullTimerOverhead = UINT64_MAX;
+	for( int i = 0; i < 10000; i++ )
+	{
+		ullStart = prvReadTimer();
+		ullTime = prvReadTimer() - ullStart;
+		if( ullTime < ullTimerOverhead )
+		{
+			ullTimerOverhead = ullTime;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void *prvCheckedAlloc( size_t xSize )
+{
+void *pv = malloc( xSize );
+
+	if( pv == NULL )
+	{
+		fprintf( stderr, "out of host memory\n" );
+		exit( 1 );
+	}
+
+	return pv;
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddOp( BenchRun_t *pxRun, size_t *pxCapacity, size_t xBlock, size_t xSize )
+{
+	if( pxRun->xOps == *pxCapacity )
+	{
+		*pxCapacity = ( *pxCapacity == 0 ) ? 4096 : *pxCapacity * 2;
+		pxRun->pxOps = realloc( pxRun->pxOps, *pxCapacity * sizeof( BenchOp_t ) );
+		if( pxRun->pxOps == NULL )
+		{
+			fprintf( stderr, "out of host memory\n" );
+			exit( 1 );
+		}
+	}
+
+	pxRun->pxOps[ pxRun->xOps ].xBlock = xBlock;
+	pxRun->pxOps[ pxRun->xOps ].xSize = xSize;
+	pxRun->xOps++;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Keys in a trace are mapped to block numbers through an open addressed hash
+ * table, which is rebuilt twice the size whenever it gets half full.
+ */
+typedef struct BenchKey
+{
+	unsigned long long ullKey;
+	size_t xBlock;		/* SIZE_MAX if the key is not live. */
+	int iUsed;
+} BenchKey_t;
+
+static BenchKey_t *pxKeys = NULL;
+static size_t xKeyCapacity = 0, xKeysUsed = 0;
+
+static BenchKey_t *prvFindKey( unsigned long long ullKey )
+{
+size_t x;
+
+	if( ( xKeysUsed + 1 ) * 2 > xKeyCapacity )
+	{
+	BenchKey_t *pxOld = pxKeys;
+	size_t xOldCapacity = xKeyCapacity;
+
+		xKeyCapacity = ( xKeyCapacity == 0 ) ? 1024 : xKeyCapacity * 2;
+		pxKeys = calloc( xKeyCapacity, sizeof( BenchKey_t ) );
+		if( pxKeys == NULL )
+		{
+			fprintf( stderr, "out of host memory\n" );
+			exit( 1 );
+		}
+		xKeysUsed = 0;
+
+		for( size_t i = 0; i < xOldCapacity; i++ )
+		{
+			if( pxOld[ i ].iUsed )
+			{
+				*prvFindKey( pxOld[ i ].ullKey ) = pxOld[ i ];
+			}
+		}
+		free( pxOld );
+	}
+
+	x = ( size_t ) ( ( ullKey * 0x9E3779B97F4A7C15ULL ) >> 20 ) & ( xKeyCapacity - 1 );
+	while( pxKeys[ x ].iUsed && ( pxKeys[ x ].ullKey != ullKey ) )
+	{
+		x = ( x + 1 ) & ( xKeyCapacity - 1 );
+	}
+
+	if( !pxKeys[ x ].iUsed )
+	{
+		pxKeys[ x ].iUsed = 1;
+		pxKeys[ x ].ullKey = ullKey;
+		pxKeys[ x ].xBlock = SIZE_MAX;
+		xKeysUsed++;
+	}
+
+	return &pxKeys[ x ];
+}
+/*-----------------------------------------------------------*/
+
+static void prvLoadTrace( const char *pcFileName, BenchRun_t *pxRun )
+{
+FILE *pxFile;
+char cLine[ 256 ], cOp;
+unsigned long long ullKey, ullSize;
+size_t xCapacity = 0, xLine = 0;
+BenchKey_t *pxKey;
+int iFields;
+
+	pxFile = fopen( pcFileName, "r" );
+	if( pxFile == NULL )
+	{
+		perror( pcFileName );
+		exit( 1 );
+	}
+
+	while( fgets( cLine, sizeof( cLine ), pxFile ) != NULL )
+	{
+		xLine++;
+		if( ( cLine[ 0 ] == '#' ) || ( cLine[ 0 ] == '\n' ) )
+		{
+			continue;
+		}
+
+		ullSize = 0;
+		iFields = sscanf( cLine, " %c %lli %lli", &cOp, &ullKey, &ullSize );
+
+		if( ( cOp == 'm' ) && ( iFields == 3 ) )
+		{
+			prvFindKey( ullKey )->xBlock = pxRun->xBlocks;
+			prvAddOp( pxRun, &xCapacity, pxRun->xBlocks++, ( size_t ) ullSize );
+		}
+		else if( ( cOp == 'f' ) && ( iFields >= 2 ) )
+		{
+			pxKey = prvFindKey( ullKey );
+			if( pxKey->xBlock != SIZE_MAX )
+			{
+				prvAddOp( pxRun, &xCapacity, pxKey->xBlock, 0 );
+				pxKey->xBlock = SIZE_MAX;
+			}
+		}
+		else
+		{
+			fprintf( stderr, "%s:%lu: not an operation\n", pcFileName, ( unsigned long ) xLine );
+			exit( 1 );
+		}
+	}
+
+	fclose( pxFile );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRandom( uint32_t *pulState )
+{
+	/* xorshift32. */
+	*pulState ^= *pulState << 13;
+	*pulState ^= *pulState >> 17;
+	*pulState ^= *pulState << 5;
+	return *pulState;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvRandomSize( int iDist, uint32_t *pulState )
+{
+uint32_t ulClass = prvRandom( pulState ) % 100;
+
+	switch( iDist )
+	{
+		case benchDIST_UNIFORM:
+			return 1 + ( prvRandom( pulState ) % 1024 );
+
+		case benchDIST_MIXED:
+			if( ulClass < 70 )
+			{
+				return 1 + ( prvRandom( pulState ) % 128 );
+			}
+			else if( ulClass < 95 )
+			{
+				return 129 + ( prvRandom( pulState ) % 896 );
+			}
+			return 1025 + ( prvRandom( pulState ) % 7168 );
+
+		default:
+			if( ulClass < 90 )
+			{
+				return 1 + ( prvRandom( pulState ) % 128 );
+			}
+			return 129 + ( prvRandom( pulState ) % 896 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvGenerate( int iDist, size_t xOps, size_t xLive, uint32_t ulSeed, BenchRun_t *pxRun )
+{
+size_t *pxLiveBlocks = prvCheckedAlloc( ( xLive + 1 ) * sizeof( size_t ) );
+size_t xLiveCount = 0, xCapacity = 0, x;
+uint32_t ulState = ( ulSeed != 0 ) ? ulSeed : 1;
+BaseType_t xAllocate;
+
+	while( pxRun->xOps < xOps )
+	{
+		/* Drift towards xLive blocks allocated. */
+		if( xLiveCount == 0 )
+		{
+			xAllocate = pdTRUE;
+		}
+		else if( xLiveCount > xLive )
+		{
+			xAllocate = pdFALSE;
+		}
+		else
+		{
+			xAllocate = ( ( prvRandom( &ulState ) % 100 ) < ( ( xLiveCount < xLive ) ? 60U : 40U ) ) ? pdTRUE : pdFALSE;
+		}
+
+		if( xAllocate == pdTRUE )
+		{
+			pxLiveBlocks[ xLiveCount++ ] = pxRun->xBlocks;
+			prvAddOp( pxRun, &xCapacity, pxRun->xBlocks++, prvRandomSize( iDist, &ulState ) );
+		}
+		else
+		{
+			x = prvRandom( &ulState ) % xLiveCount;
+			prvAddOp( pxRun, &xCapacity, pxLiveBlocks[ x ], 0 );
+			pxLiveBlocks[ x ] = pxLiveBlocks[ --xLiveCount ];
+		}
+	}
+
+	free( pxLiveBlocks );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Checks that a large aligned allocation can be had from a heap that has only
+ * just been initialised, so nothing is yet on its free lists, and that freeing
+ * it gives all the space back.
+ */
+static void prvCheckAligned( const HeapBenchAllocator_t *pxHeap )
+{
+size_t xBaseFree = pxHeap->xGetFreeHeapSize();
+size_t xAlignment;
+void *pv;
+
+	for( xAlignment = portBYTE_ALIGNMENT * 2; xAlignment <= 256; xAlignment *= 2 )
+	{
+		pv = pxHeap->pvMallocAligned( configTOTAL_HEAP_SIZE / 8, xAlignment );
+		if( ( pv == NULL ) || ( ( ( uintptr_t ) pv & ( xAlignment - 1 ) ) != 0 ) )
+		{
+			fprintf( stderr, "%s: aligned allocation of %lu bytes to %lu failed\n", pxHeap->pcName,
+					 ( unsigned long ) ( configTOTAL_HEAP_SIZE / 8 ), ( unsigned long ) xAlignment );
+			exit( 1 );
+		}
+
+		memset( pv, 0xA5, configTOTAL_HEAP_SIZE / 8 );
+		pxHeap->vFree( pv );
+
+		if( pxHeap->xGetFreeHeapSize() != xBaseFree )
+		{
+			fprintf( stderr, "%s: %lu bytes free after an aligned allocation, %lu before\n", pxHeap->pcName,
+					 ( unsigned long ) pxHeap->xGetFreeHeapSize(), ( unsigned long ) xBaseFree );
+			exit( 1 );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvRun( const HeapBenchAllocator_t *pxHeap, const BenchRun_t *pxRun, BenchResult_t *pxResult )
+{
+void **ppvBlocks = calloc( pxRun->xBlocks + 1, sizeof( void * ) );
+size_t *pxSizes = calloc( pxRun->xBlocks + 1, sizeof( size_t ) );
+size_t xLive = 0, xInUse;
+uint64_t ullStart, ullTime;
+const BenchOp_t *pxOp;
+void *pv;
+
+	if( ( ppvBlocks == NULL ) || ( pxSizes == NULL ) )
+	{
+		fprintf( stderr, "out of host memory\n" );
+		exit( 1 );
+	}
+
+	memset( pxResult, 0, sizeof( *pxResult ) );
+	pxResult->pullMallocTimes = prvCheckedAlloc( ( pxRun->xOps + 1 ) * sizeof( uint64_t ) );
+	pxResult->pullFreeTimes = prvCheckedAlloc( ( pxRun->xOps + 1 ) * sizeof( uint64_t ) );
+
+	/* Let the heap initialise itself outside the measurements. */
+	pxRunningHeap = pxHeap;
+	pxHeap->vInit( xPoolSizes, xPoolCount );
+	pxHeap->vFree( pxHeap->pvMalloc( 1 ) );
+	pxResult->xBaseFree = pxHeap->xGetFreeHeapSize();
+
+	if( pxHeap->pvMallocAligned != NULL )
+	{
+		prvCheckAligned( pxHeap );
+	}
+
+	for( size_t i = 0; i < pxRun->xOps; i++ )
+	{
+		pxOp = &( pxRun->pxOps[ i ] );
+
+		if( pxOp->xSize != 0 )
+		{
+			ullStart = prvReadTimer();
+			pv = pxHeap->pvMalloc( pxOp->xSize );
+			ullTime = prvReadTimer() - ullStart;
+			pxResult->pullMallocTimes[ pxResult->xMallocs++ ] = ( ullTime > ullTimerOverhead ) ? ullTime - ullTimerOverhead : 0;
+
+			if( pv != NULL )
+			{
+				/* Touch the block so a heap that hands out overlapping or
+				out of range blocks fails under the sanitizers. */
+				memset( pv, 0xA5, pxOp->xSize );
+				ppvBlocks[ pxOp->xBlock ] = pv;
+				pxSizes[ pxOp->xBlock ] = pxOp->xSize;
+				xLive += pxOp->xSize;
+			}
+			else
+			{
+				if( pxResult->xFailures == 0 )
+				{
+					pxResult->xFirstFailure = i;
+					pxResult->xFirstFailureSize = pxOp->xSize;
+					pxResult->xFreeAtFirstFailure = pxHeap->xGetFreeHeapSize();
+				}
+				pxResult->xFailures++;
+			}
+		}
+		else if( ppvBlocks[ pxOp->xBlock ] != NULL )
+		{
+			ullStart = prvReadTimer();
+			pxHeap->vFree( ppvBlocks[ pxOp->xBlock ] );
+			ullTime = prvReadTimer() - ullStart;
+			pxResult->pullFreeTimes[ pxResult->xFrees++ ] = ( ullTime > ullTimerOverhead ) ? ullTime - ullTimerOverhead : 0;
+
+			ppvBlocks[ pxOp->xBlock ] = NULL;
+			xLive -= pxSizes[ pxOp->xBlock ];
+		}
+
+		xInUse = pxResult->xBaseFree - pxHeap->xGetFreeHeapSize();
+		if( xInUse > pxResult->xPeakInUse )
+		{
+			pxResult->xPeakInUse = xInUse;
+			pxResult->xLiveAtPeak = xLive;
+		}
+	}
+
+	/* Find the largest block that can still be had.  This counts down rather
+	than searching, as a failed allocation leaves every heap as it was but one
+	that succeeds splits a block that heap_2.c never joins back together. */
+	pxResult->xFreeAtEnd = pxHeap->xGetFreeHeapSize();
+	pxResult->xLargestAtEnd = pxResult->xFreeAtEnd & ~( ( size_t ) portBYTE_ALIGNMENT - 1 );
+	while( pxResult->xLargestAtEnd > 0 )
+	{
+		pv = pxHeap->pvMalloc( pxResult->xLargestAtEnd );
+		if( pv != NULL )
+		{
+			pxHeap->vFree( pv );
+			break;
+		}
+		pxResult->xLargestAtEnd -= portBYTE_ALIGNMENT;
+	}
+
+	for( size_t i = 0; i < pxRun->xBlocks; i++ )
+	{
+		pxHeap->vFree( ppvBlocks[ i ] );
+	}
+
+	free( ppvBlocks );
+	free( pxSizes );
+}
+/*-----------------------------------------------------------*/
+
+static int prvCompareTimes( const void *pv1, const void *pv2 )
+{
+uint64_t ull1 = *( const uint64_t * ) pv1, ull2 = *( const uint64_t * ) pv2;
+
+	return ( ull1 > ull2 ) - ( ull1 < ull2 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReportTimes( const char *pcName, uint64_t *pullTimes, size_t xCount )
+{
+	if( xCount == 0 )
+	{
+		printf( "  %-6s none\n", pcName );
+		return;
+	}
+
+	qsort( pullTimes, xCount, sizeof( uint64_t ), prvCompareTimes );
+	printf( "  %-6s p50 %6llu  p99 %6llu  max %8llu %s over %lu calls\n", pcName,
+			( unsigned long long ) pullTimes[ ( xCount - 1 ) / 2 ],
+			( unsigned long long ) pullTimes[ ( ( xCount - 1 ) * 99 ) / 100 ],
+			( unsigned long long ) pullTimes[ xCount - 1 ],
+			benchTIMER_UNIT, ( unsigned long ) xCount );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReport( const HeapBenchAllocator_t *pxHeap, BenchResult_t *pxResult )
+{
+	printf( "%s\n", pxHeap->pcName );
+	prvReportTimes( "malloc", pxResult->pullMallocTimes, pxResult->xMallocs );
+	prvReportTimes( "free", pxResult->pullFreeTimes, pxResult->xFrees );
+
+	printf( "  peak   %lu bytes in use for %lu bytes requested", ( unsigned long ) pxResult->xPeakInUse, ( unsigned long ) pxResult->xLiveAtPeak );
+	if( pxResult->xLiveAtPeak != 0 )
+	{
+		printf( ", %.1f%% overhead", 100.0 * ( double ) ( pxResult->xPeakInUse - pxResult->xLiveAtPeak ) / ( double ) pxResult->xLiveAtPeak );
+	}
+	printf( "\n" );
+
+	if( pxResult->xFailures == 0 )
+	{
+		printf( "  fails  none\n" );
+	}
+	else
+	{
+		printf( "  fails  %lu, the first at operation %lu, %lu bytes with %lu bytes free\n",
+				( unsigned long ) pxResult->xFailures, ( unsigned long ) pxResult->xFirstFailure,
+				( unsigned long ) pxResult->xFirstFailureSize, ( unsigned long ) pxResult->xFreeAtFirstFailure );
+	}
+
+	printf( "  end    %lu bytes free, largest allocation %lu bytes", ( unsigned long ) pxResult->xFreeAtEnd, ( unsigned long ) pxResult->xLargestAtEnd );
+	if( pxResult->xFreeAtEnd != 0 )
+	{
+		printf( ", %.1f%% fragmented", ( pxResult->xLargestAtEnd >= pxResult->xFreeAtEnd ) ? 0.0 :
+				100.0 * ( double ) ( pxResult->xFreeAtEnd - pxResult->xLargestAtEnd ) / ( double ) pxResult->xFreeAtEnd );
+	}
+	printf( "\n" );
+
+	free( pxResult->pullMallocTimes );
+	free( pxResult->pullFreeTimes );
+}
+/*-----------------------------------------------------------*/
+
+static void prvUsage( const char *pcName )
+{
+	fprintf( stderr, "usage: %s [--trace <file>] [--dist small|uniform|mixed] [--ops <n>] [--live <n>]\n"
+					 "          [--seed <n>] [--heaps heap_2,heap_4,heap_6,heap_777] [--pools <size>,...]\n", pcName );
+	exit( 2 );
+}
+/*-----------------------------------------------------------*/
+
+int main( int argc, char **argv )
+{
+const char *pcTrace = NULL, *pcHeaps = NULL;
+int iDist = benchDIST_SMALL;
+size_t xOps = 100000, xLive = 200;
+uint32_t ulSeed = 1;
+BenchRun_t xRun = { NULL, 0, 0 };
+BenchResult_t xResult;
+char *pcEnd;
+
+	for( int i = 1; i < argc; i++ )
+	{
+		if( i + 1 >= argc )
+		{
+			prvUsage( argv[ 0 ] );
+		}
+		else if( strcmp( argv[ i ], "--trace" ) == 0 )
+		{
+			pcTrace = argv[ ++i ];
+		}
+		else if( strcmp( argv[ i ], "--dist" ) == 0 )
+		{
+			i++;
+			if( strcmp( argv[ i ], "small" ) == 0 )
+			{
+				iDist = benchDIST_SMALL;
+			}
+			else if( strcmp( argv[ i ], "uniform" ) == 0 )
+			{
+				iDist = benchDIST_UNIFORM;
+			}
+			else if( strcmp( argv[ i ], "mixed" ) == 0 )
+			{
+				iDist = benchDIST_MIXED;
+			}
+			else
+			{
+				prvUsage( argv[ 0 ] );
+			}
+		}
+		else if( strcmp( argv[ i ], "--ops" ) == 0 )
+		{
+			xOps = strtoul( argv[ ++i ], NULL, 0 );
+		}
+		else if( strcmp( argv[ i ], "--live" ) == 0 )
+		{
+			xLive = strtoul( argv[ ++i ], NULL, 0 );
+		}
+		else if( strcmp( argv[ i ], "--seed" ) == 0 )
+		{
+			ulSeed = ( uint32_t ) strtoul( argv[ ++i ], NULL, 0 );
+		}
+		else if( strcmp( argv[ i ], "--heaps" ) == 0 )
+		{
+			pcHeaps = argv[ ++i ];
+		}
+		else if( strcmp( argv[ i ], "--pools" ) == 0 )
+		{
+			pcEnd = argv[ ++i ];
+			while( ( *pcEnd != '\0' ) && ( xPoolCount < benchMAX_POOLS ) )
+			{
+				xPoolSizes[ xPoolCount++ ] = strtoul( pcEnd, &pcEnd, 0 );
+				if( *pcEnd == ',' )
+				{
+					pcEnd++;
+				}
+			}
+		}
+		else
+		{
+			prvUsage( argv[ 0 ] );
+		}
+	}
+
+	if( pcTrace != NULL )
+	{
+		prvLoadTrace( pcTrace, &xRun );
+		printf( "%lu operations on %lu blocks from %s, %lu byte heaps\n\n", ( unsigned long ) xRun.xOps,
+				( unsigned long ) xRun.xBlocks, pcTrace, ( unsigned long ) configTOTAL_HEAP_SIZE );
+	}
+	else
+	{
+		prvGenerate( iDist, xOps, ( xLive > 0 ) ? xLive : 1, ulSeed, &xRun );
+		printf( "%lu generated operations on %lu blocks, about %lu live, %lu byte heaps\n\n", ( unsigned long ) xRun.xOps,
+				( unsigned long ) xRun.xBlocks, ( unsigned long ) xLive, ( unsigned long ) configTOTAL_HEAP_SIZE );
+	}
+
+	prvCalibrateTimer();
+
+	for( size_t i = 0; i < sizeof( pxAllAllocators ) / sizeof( pxAllAllocators[ 0 ] ); i++ )
+	{
+		if( ( pcHeaps == NULL ) || ( strstr( pcHeaps, pxAllAllocators[ i ]->pcName ) != NULL ) )
+		{
+			prvRun( pxAllAllocators[ i ], &xRun, &xResult );
+			prvReport( pxAllAllocators[ i ], &xResult );
+		}
+	}
+
+	free( xRun.pxOps );
+	free( pxKeys );
+
+	return 0;
+}
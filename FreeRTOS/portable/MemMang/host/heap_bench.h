@@ -0,0 +1,61 @@
+/*
+ * Shared between heap_bench.c and the files that wrap each heap
+ * implementation, see heap_bench.c.
+ */
+#ifndef HEAP_BENCH_H
+#define HEAP_BENCH_H
+
+#include <stddef.h>
+
+/* One heap implementation, built with its public functions renamed so that
+several can be linked into the same program. */
+typedef struct HeapBenchAllocator
+{
+	const char *pcName;
+	void ( *vInit )( const size_t *pxPoolSizes, size_t xPoolCount );	/* Called once before the first allocation. */
+	void *( *pvMalloc )( size_t xSize );
+	void ( *vFree )( void *pv );
+	size_t ( *xGetFreeHeapSize )( void );
+	void *( *pvMallocAligned )( size_t xSize, size_t xAlignment );	/* NULL if the heap has no pvPortMallocAligned(). */
+} HeapBenchAllocator_t;
+
+extern const HeapBenchAllocator_t xBenchHeap2;
+extern const HeapBenchAllocator_t xBenchHeap4;
+extern const HeapBenchAllocator_t xBenchHeap6;
+extern const HeapBenchAllocator_t xBenchHeap777;
+
+/* Define heapBENCH_PREFIX and include this before a heap implementation to
+give each of its public names that prefix. */
+#ifdef heapBENCH_PREFIX
+
+	#define heapBENCH_CAT2( a, b )	a##_##b
+	#define heapBENCH_CAT( a, b )	heapBENCH_CAT2( a, b )
+	#define heapBENCH_NAME( x )		heapBENCH_CAT( heapBENCH_PREFIX, x )
+
+	#define pvPortMalloc						heapBENCH_NAME( pvPortMalloc )
+	#define vPortFree							heapBENCH_NAME( vPortFree )
+	#define xPortGetFreeHeapSize				heapBENCH_NAME( xPortGetFreeHeapSize )
+	#define xPortGetMinimumEverFreeHeapSize		heapBENCH_NAME( xPortGetMinimumEverFreeHeapSize )
+	#define vPortInitialiseBlocks				heapBENCH_NAME( vPortInitialiseBlocks )
+	#define vPortDefineHeapRegions				heapBENCH_NAME( vPortDefineHeapRegions )
+	#define vPortDefineHeapRegionsCaps			heapBENCH_NAME( vPortDefineHeapRegionsCaps )
+	#define pvPortMallocCaps					heapBENCH_NAME( pvPortMallocCaps )
+	#define pvPortMallocAligned					heapBENCH_NAME( pvPortMallocAligned )
+	#define pvPortRealloc						heapBENCH_NAME( pvPortRealloc )
+	#define vPortPoolInit						heapBENCH_NAME( vPortPoolInit )
+	#define vPortPoolInitRegions				heapBENCH_NAME( vPortPoolInitRegions )
+	#define pvPortMallocBatch					heapBENCH_NAME( pvPortMallocBatch )
+	#define vPortFreeBatch						heapBENCH_NAME( vPortFreeBatch )
+	#define pvPortMallocFromISR					heapBENCH_NAME( pvPortMallocFromISR )
+	#define vPortFreeFromISR					heapBENCH_NAME( vPortFreeFromISR )
+	#define xPortTaskCacheCreate				heapBENCH_NAME( xPortTaskCacheCreate )
+	#define vPortTaskCacheDelete				heapBENCH_NAME( vPortTaskCacheDelete )
+	#define vPortGetHeapStats					heapBENCH_NAME( vPortGetHeapStats )
+	#define xPortGetHeapSnapshot				heapBENCH_NAME( xPortGetHeapSnapshot )
+	#define xPortCoalesceFreeBlocks				heapBENCH_NAME( xPortCoalesceFreeBlocks )
+	#define vPrintFreeList						heapBENCH_NAME( vPrintFreeList )
+	#define xSizeList							heapBENCH_NAME( xSizeList )
+
+#endif /* heapBENCH_PREFIX */
+
+#endif /* HEAP_BENCH_H */
@@ -0,0 +1,16 @@
+/*
+ * heap_6.c built for heap_bench.c.
+ */
+#define heapBENCH_PREFIX	heap_6
+#include "heap_bench.h"
+
+#include "../../../../heap_6.c"
+
+static void prvInit( const size_t *pxPoolSizes, size_t xPoolCount )
+{
+	/* There are no pools to set up. */
+	( void ) pxPoolSizes;
+	( void ) xPoolCount;
+}
+
+const HeapBenchAllocator_t xBenchHeap6 = { "heap_6", prvInit, pvPortMalloc, vPortFree, xPortGetFreeHeapSize, NULL };
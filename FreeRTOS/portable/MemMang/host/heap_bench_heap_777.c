@@ -0,0 +1,49 @@
+/*
+ * heap_777.c built for heap_bench.c.
+ */
+#define heapBENCH_PREFIX	heap_777
+#include "heap_bench.h"
+
+#include "../heap_777.c"
+
+#if( configHEAP_USE_REGIONS == 1 )
+	/* heap_777.c has no heap array of its own then, so this one is given to
+	it in two halves. */
+	static uint8_t ucBenchHeap[ configTOTAL_HEAP_SIZE ];
+#endif
+
+static void prvInit( const size_t *pxPoolSizes, size_t xPoolCount )
+{
+BaseType_t xResult;
+
+	#if( configHEAP_USE_REGIONS == 1 )
+	{
+	const HeapRegion_t xRegions[] =
+	{
+		{ ucBenchHeap, configTOTAL_HEAP_SIZE / 2 },
+		{ ucBenchHeap + ( configTOTAL_HEAP_SIZE / 2 ), configTOTAL_HEAP_SIZE - ( configTOTAL_HEAP_SIZE / 2 ) },
+		{ NULL, 0 }
+	};
+
+		vPortDefineHeapRegions( xRegions );
+	}
+	#endif
+
+	/* Without a list the default xSizeList classes are used. */
+	if( xPoolCount > 0 )
+	{
+		xResult = vPortPoolInit( pxPoolSizes, NULL, xPoolCount );
+		configASSERT( xResult == pdTRUE );
+	}
+
+	#if( configHEAP_USE_TASK_CACHE == 1 )
+	{
+		xResult = xPortTaskCacheCreate();
+		configASSERT( xResult == pdTRUE );
+	}
+	#endif
+
+	( void ) xResult;
+}
+
+const HeapBenchAllocator_t xBenchHeap777 = { "heap_777", prvInit, pvPortMalloc, vPortFree, xPortGetFreeHeapSize, pvPortMallocAligned };
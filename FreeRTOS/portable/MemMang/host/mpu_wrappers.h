@@ -0,0 +1,9 @@
+/* The host build of the heap benchmark has no MPU. */
+#ifndef MPU_WRAPPERS_H
+#define MPU_WRAPPERS_H
+
+#define portUSING_MPU_WRAPPERS	0
+#define PRIVILEGED_FUNCTION
+#define PRIVILEGED_DATA
+
+#endif /* MPU_WRAPPERS_H */
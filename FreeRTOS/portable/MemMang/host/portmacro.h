@@ -0,0 +1,25 @@
+/*
+ * Port definitions for the host build of the heap benchmark, see
+ * heap_bench.c.  There is a single thread, so critical sections do nothing.
+ */
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+#include <stdint.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define portSTACK_TYPE							uint32_t
+typedef portSTACK_TYPE StackType_t;
+
+#define portBYTE_ALIGNMENT						8
+#define portPOINTER_SIZE_TYPE					uintptr_t
+
+#define portENTER_CRITICAL()
+#define portEXIT_CRITICAL()
+#define portSET_INTERRUPT_MASK_FROM_ISR()		( ( UBaseType_t ) 0 )
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR( x )	( void ) ( x )
+
+#endif /* PORTMACRO_H */
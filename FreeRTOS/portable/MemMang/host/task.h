@@ -0,0 +1,26 @@
+/*
+ * The parts of task.h the heap implementations use, for the host build of the
+ * heap benchmark.  See heap_bench.c for the implementations.
+ */
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+typedef void * TaskHandle_t;
+
+#define taskSCHEDULER_SUSPENDED		( ( BaseType_t ) 0 )
+#define taskSCHEDULER_NOT_STARTED	( ( BaseType_t ) 1 )
+#define taskSCHEDULER_RUNNING		( ( BaseType_t ) 2 )
+
+#define taskENTER_CRITICAL()				portENTER_CRITICAL()
+#define taskEXIT_CRITICAL()					portEXIT_CRITICAL()
+#define taskENTER_CRITICAL_FROM_ISR()		portSET_INTERRUPT_MASK_FROM_ISR()
+#define taskEXIT_CRITICAL_FROM_ISR( x )		portCLEAR_INTERRUPT_MASK_FROM_ISR( x )
+
+void vTaskSuspendAll( void );
+BaseType_t xTaskResumeAll( void );
+BaseType_t xTaskGetSchedulerState( void );
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+void *pvTaskGetThreadLocalStoragePointer( TaskHandle_t xTaskToQuery, BaseType_t xIndex );
+void vTaskSetThreadLocalStoragePointer( TaskHandle_t xTaskToSet, BaseType_t xIndex, void *pvValue );
+
+#endif /* INC_TASK_H */
@@ -31,6 +31,20 @@
  * into a single larger block (and so will fragment memory).  See heap_4.c for
  * an equivalent that does combine adjacent blocks into single larger blocks.
  *
+ * Setting configHEAP_USE_DEFERRED_COALESCING to 1 in FreeRTOSConfig.h adds
+ * xPortCoalesceFreeBlocks(), which merges adjacent free blocks in one pass
+ * that can be run from the idle hook.  The free list stays ordered by size, so
+ * pvPortMalloc() keeps its best fit search and vPortFree() does no more work
+ * than before.  The pass sorts the free list by address, merges neighbours,
+ * then sorts it back by size, all in place - it is O( n log n ) in the number
+ * of free blocks and runs with the scheduler suspended.  It returns straight
+ * away if nothing has been freed since the last pass.
+ *
+ * Setting configHEAP_COALESCE_ON_FAILURE to 1 as well makes pvPortMalloc() run
+ * the pass itself, once, before it gives up on a request.  That call then
+ * costs the whole O( n log n ) pass, with the scheduler suspended, so leave it
+ * at 0 where the worst case time of an allocation matters.
+ *
  * See heap_1.c, heap_3.c and heap_4.c for alternative implementations, and the
  * memory management pages of http://www.FreeRTOS.org for more information.
  */
@@ -53,11 +67,40 @@ task.h is included from an application file. */
 /* A few bytes might be lost to byte aligning the heap start address. */
 #define configADJUSTED_HEAP_SIZE	( configTOTAL_HEAP_SIZE - portBYTE_ALIGNMENT )
 
+#ifndef configHEAP_USE_DEFERRED_COALESCING
+	#define configHEAP_USE_DEFERRED_COALESCING	0
+#endif
+
+#ifndef configHEAP_COALESCE_ON_FAILURE
+	#define configHEAP_COALESCE_ON_FAILURE	0
+#endif
+
+#if( configHEAP_COALESCE_ON_FAILURE == 1 ) && ( configHEAP_USE_DEFERRED_COALESCING == 0 )
+	#error configHEAP_COALESCE_ON_FAILURE needs configHEAP_USE_DEFERRED_COALESCING
+#endif
+
 /*
  * Initialises the heap structures before their first use.
  */
 static void prvHeapInit( void );
 
+#if( configHEAP_USE_DEFERRED_COALESCING == 1 )
+
+	/*
+	 * Merge every pair of adjacent free blocks, leaving the free list ordered by
+	 * size.  Returns the number of blocks merged away.  Must be called with the
+	 * scheduler suspended.
+	 */
+	static size_t prvCoalesceFreeList( void );
+
+	/*
+	 * Sort the blocks between xStart and xEnd, by address if xByAddress is
+	 * pdTRUE and by size otherwise, keeping the order of equal blocks.
+	 */
+	static void prvSortFreeList( BaseType_t xByAddress );
+
+#endif /* configHEAP_USE_DEFERRED_COALESCING */
+
 /* Allocate the memory for the heap. */
 #if( configAPPLICATION_ALLOCATED_HEAP == 1 )
 	/* The application writer has already defined the array used for the RTOS
@@ -87,6 +130,12 @@ static BlockLink_t xStart, xEnd;
 fragmentation. */
 static size_t xFreeBytesRemaining = configADJUSTED_HEAP_SIZE;
 
+#if( configHEAP_USE_DEFERRED_COALESCING == 1 )
+	/* Cleared by vPortFree(), set once a pass has merged every neighbour.
+	Splitting a block in pvPortMalloc() can not create new neighbours. */
+	static BaseType_t xFreeListIsCoalesced = pdTRUE;
+#endif
+
 /* STATIC FUNCTIONS ARE DEFINED AS MACROS TO MINIMIZE THE FUNCTION CALL DEPTH. */
 
 /*
@@ -99,6 +148,7 @@ static size_t xFreeBytesRemaining = configADJUSTED_HEAP_SIZE;
 BlockLink_t *pxIterator;															\
 size_t xBlockSize;																	\
 																					\
+	portHEAP_TIMING_START( portHEAP_TIMING_INSERT );								\
 	xBlockSize = pxBlockToInsert->xBlockSize;										\
 																					\
 	/* Iterate through the list until a block is found that has a larger size */	\
@@ -112,6 +162,23 @@ size_t xBlockSize;																	\
 	/* position. */																	\
 	pxBlockToInsert->pxNextFreeBlock = pxIterator->pxNextFreeBlock;					\
 	pxIterator->pxNextFreeBlock = pxBlockToInsert;									\
+																					\
+	portHEAP_TIMING_STOP( portHEAP_TIMING_INSERT );									\
+}
+
+/*
+ * Find the smallest free block of at least xWantedSize bytes.  pxBlock is left
+ * pointing at xEnd if there is none.
+ */
+#define prvFindFreeBlock( xWantedSize, pxPreviousBlock, pxBlock )					\
+{																					\
+	pxPreviousBlock = &xStart;														\
+	pxBlock = xStart.pxNextFreeBlock;												\
+	while( ( pxBlock->xBlockSize < xWantedSize ) && ( pxBlock->pxNextFreeBlock != NULL ) )	\
+	{																				\
+		pxPreviousBlock = pxBlock;													\
+		pxBlock = pxBlock->pxNextFreeBlock;											\
+	}																				\
 }
 /*-----------------------------------------------------------*/
 
@@ -120,9 +187,14 @@ void *pvPortMalloc( size_t xWantedSize )
 BlockLink_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
 static BaseType_t xHeapHasBeenInitialised = pdFALSE;
 void *pvReturn = NULL;
+#if( configHEAP_USE_TRACE == 1 ) || ( configHEAP_USE_GUARDS == 1 ) || ( configHEAP_USE_RECLAIM == 1 )
+	const size_t xRequestedSize = xWantedSize;
+#endif
 
 	vTaskSuspendAll();
 	{
+		portHEAP_TIMING_START( portHEAP_TIMING_MALLOC );
+
 		/* If this is the first call to malloc then the heap will require
 		initialisation to setup the list of free blocks. */
 		if( xHeapHasBeenInitialised == pdFALSE )
@@ -132,10 +204,11 @@ void *pvReturn = NULL;
 		}
 
 		/* The wanted size is increased so it can contain a BlockLink_t
-		structure in addition to the requested amount of bytes. */
+		structure, and any red zone, in addition to the requested amount of
+		bytes. */
 		if( xWantedSize > 0 )
 		{
-			xWantedSize += heapSTRUCT_SIZE;
+			xWantedSize += heapSTRUCT_SIZE + portHEAP_GUARD_OVERHEAD;
 
 			/* Ensure that blocks are always aligned to the required number of bytes. */
 			if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0 )
@@ -149,13 +222,21 @@ void *pvReturn = NULL;
 		{
 			/* Blocks are stored in byte order - traverse the list from the start
 			(smallest) block until one of adequate size is found. */
-			pxPreviousBlock = &xStart;
-			pxBlock = xStart.pxNextFreeBlock;
-			while( ( pxBlock->xBlockSize < xWantedSize ) && ( pxBlock->pxNextFreeBlock != NULL ) )
+			prvFindFreeBlock( xWantedSize, pxPreviousBlock, pxBlock );
+
+			#if( configHEAP_COALESCE_ON_FAILURE == 1 )
 			{
-				pxPreviousBlock = pxBlock;
-				pxBlock = pxBlock->pxNextFreeBlock;
+				/* The memory might be there in pieces that have not been
+				merged yet. */
+				if( ( pxBlock == &xEnd ) && ( xFreeListIsCoalesced == pdFALSE ) )
+				{
+					if( prvCoalesceFreeList() != 0 )
+					{
+						prvFindFreeBlock( xWantedSize, pxPreviousBlock, pxBlock );
+					}
+				}
 			}
+			#endif
 
 			/* If we found the end marker then a block of adequate size was not found. */
 			if( pxBlock != &xEnd )
@@ -186,11 +267,34 @@ void *pvReturn = NULL;
 				}
 
 				xFreeBytesRemaining -= pxBlock->xBlockSize;
+				portHEAP_TAG_RECORD( pvReturn, pxBlock->xBlockSize );
+				portHEAP_GUARD_ARM( pvReturn, xRequestedSize, pxBlock->xBlockSize - heapSTRUCT_SIZE );
 			}
 		}
+
+		portHEAP_TIMING_STOP( portHEAP_TIMING_MALLOC );
 	}
 	( void ) xTaskResumeAll();
 
+	portHEAP_TRACE_MALLOC( pvReturn, xRequestedSize );
+
+	#if( configHEAP_USE_RECLAIM == 1 )
+	{
+		if( pvReturn != NULL )
+		{
+			vPortHeapReclaimCheck( portHEAP_RECLAIM_HEAP, xFreeBytesRemaining );
+		}
+		else if( ( xRequestedSize > 0 ) && ( xPortHeapReclaimBegin( portHEAP_RECLAIM_HEAP ) == pdTRUE ) )
+		{
+			/* The callbacks may have freed enough, so try once more.  The
+			retry calls the malloc failed hook if it fails too. */
+			pvReturn = pvPortMalloc( xRequestedSize );
+			vPortHeapReclaimEnd();
+			return pvReturn;
+		}
+	}
+	#endif
+
 	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
 	{
 		if( pvReturn == NULL )
@@ -220,11 +324,37 @@ BlockLink_t *pxLink;
 		byte alignment warnings. */
 		pxLink = ( void * ) puc;
 
+		#if( configHEAP_USE_GUARDS == 1 )
+		{
+			/* There is no allocated bit, but a block that was already freed
+			had its red zone poisoned, so fails the check. */
+			if( ( ( pxLink->xBlockSize - heapSTRUCT_SIZE ) > configADJUSTED_HEAP_SIZE ) || ( xPortHeapGuardCheck( pv, pxLink->xBlockSize - heapSTRUCT_SIZE ) == pdFALSE ) )
+			{
+				configHEAP_GUARD_FAILED( pv );
+				return;
+			}
+		}
+		#endif
+
 		vTaskSuspendAll();
 		{
+			portHEAP_TIMING_START( portHEAP_TIMING_FREE );
+
+			portHEAP_TAG_FORGET( pv );
+			portHEAP_TRACE_FREE( pv );
+			portHEAP_GUARD_POISON( pv, pxLink->xBlockSize - heapSTRUCT_SIZE );
+
 			/* Add this block to the list of free blocks. */
 			prvInsertBlockIntoFreeList( ( ( BlockLink_t * ) pxLink ) );
 			xFreeBytesRemaining += pxLink->xBlockSize;
+
+			#if( configHEAP_USE_DEFERRED_COALESCING == 1 )
+			{
+				xFreeListIsCoalesced = pdFALSE;
+			}
+			#endif
+
+			portHEAP_TIMING_STOP( portHEAP_TIMING_FREE );
 		}
 		( void ) xTaskResumeAll();
 	}
@@ -267,3 +397,137 @@ uint8_t *pucAlignedHeap;
 	pxFirstFreeBlock->pxNextFreeBlock = &xEnd;
 }
 /*-----------------------------------------------------------*/
+
+#if( configHEAP_USE_DEFERRED_COALESCING == 1 )
+
+	size_t xPortCoalesceFreeBlocks( void )
+	{
+	size_t xMerged = 0;
+
+		vTaskSuspendAll();
+		{
+			if( xFreeListIsCoalesced == pdFALSE )
+			{
+				xMerged = prvCoalesceFreeList();
+			}
+		}
+		( void ) xTaskResumeAll();
+
+		return xMerged;
+	}
+	/*-----------------------------------------------------------*/
+
+	static size_t prvCoalesceFreeList( void )
+	{
+	BlockLink_t *pxBlock, *pxNext;
+	size_t xMerged = 0;
+
+		prvSortFreeList( pdTRUE );
+
+		/* Neighbours are now next to each other in the list too. */
+		pxBlock = xStart.pxNextFreeBlock;
+		while( pxBlock != &xEnd )
+		{
+			pxNext = pxBlock->pxNextFreeBlock;
+
+			if( ( pxNext != &xEnd ) && ( ( ( uint8_t * ) pxBlock ) + pxBlock->xBlockSize == ( uint8_t * ) pxNext ) )
+			{
+				/* Stay on pxBlock, it might reach the block after pxNext too. */
+				pxBlock->xBlockSize += pxNext->xBlockSize;
+				pxBlock->pxNextFreeBlock = pxNext->pxNextFreeBlock;
+				xMerged++;
+			}
+			else
+			{
+				pxBlock = pxNext;
+			}
+		}
+
+		prvSortFreeList( pdFALSE );
+		xFreeListIsCoalesced = pdTRUE;
+
+		return xMerged;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvSortFreeList( BaseType_t xByAddress )
+	{
+	BlockLink_t *pxList, *pxTail, *pxLeft, *pxRight, *pxTake;
+	size_t xRunLength, xRuns, xLeftLength, xRightLength;
+	BaseType_t xLeftFirst;
+
+		/* A bottom up merge sort, which needs neither recursion nor extra
+		memory.  Each pass merges pairs of sorted runs of xRunLength blocks,
+		until a pass finds only one run. */
+		pxList = xStart.pxNextFreeBlock;
+
+		for( xRunLength = 1; pxList != &xEnd; xRunLength <<= 1 )
+		{
+			pxLeft = pxList;
+			pxTail = &xStart;
+			xRuns = 0;
+
+			while( pxLeft != &xEnd )
+			{
+				xRuns++;
+
+				/* Step over the left run to find the start of the right run. */
+				pxRight = pxLeft;
+				for( xLeftLength = 0; ( xLeftLength < xRunLength ) && ( pxRight != &xEnd ); xLeftLength++ )
+				{
+					pxRight = pxRight->pxNextFreeBlock;
+				}
+				xRightLength = xRunLength;
+
+				while( ( xLeftLength > 0 ) || ( ( xRightLength > 0 ) && ( pxRight != &xEnd ) ) )
+				{
+					if( xLeftLength == 0 )
+					{
+						xLeftFirst = pdFALSE;
+					}
+					else if( ( xRightLength == 0 ) || ( pxRight == &xEnd ) )
+					{
+						xLeftFirst = pdTRUE;
+					}
+					else if( xByAddress != pdFALSE )
+					{
+						xLeftFirst = ( ( uint8_t * ) pxLeft < ( uint8_t * ) pxRight ) ? pdTRUE : pdFALSE;
+					}
+					else
+					{
+						xLeftFirst = ( pxLeft->xBlockSize <= pxRight->xBlockSize ) ? pdTRUE : pdFALSE;
+					}
+
+					if( xLeftFirst != pdFALSE )
+					{
+						pxTake = pxLeft;
+						pxLeft = pxLeft->pxNextFreeBlock;
+						xLeftLength--;
+					}
+					else
+					{
+						pxTake = pxRight;
+						pxRight = pxRight->pxNextFreeBlock;
+						xRightLength--;
+					}
+
+					pxTail->pxNextFreeBlock = pxTake;
+					pxTail = pxTake;
+				}
+
+				pxLeft = pxRight;
+			}
+
+			pxTail->pxNextFreeBlock = &xEnd;
+
+			if( xRuns <= 1 )
+			{
+				break;
+			}
+
+			pxList = xStart.pxNextFreeBlock;
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* configHEAP_USE_DEFERRED_COALESCING */
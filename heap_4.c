@@ -30,10 +30,40 @@
  * (coalescences) adjacent memory blocks as they are freed, and in so doing
  * limits memory fragmentation.
  *
+ * By default the free list is kept in address order, and vPortFree() walks it
+ * to find the neighbours of the block being freed.  Setting
+ * configHEAP_USE_BOUNDARY_TAGS to 1 in FreeRTOSConfig.h instead writes the size
+ * of every free block into its last word, and marks each block whose lower
+ * neighbour is free with heapPREV_FREE_BIT.  vPortFree() then finds and merges
+ * both neighbours in constant time, and the free list becomes a doubly linked
+ * list with the most recently freed block first.  pvPortMalloc() still takes
+ * the first block that fits, but in that order rather than address order.
+ *
+ * configHEAP_FIT_POLICY picks how pvPortMalloc() searches the free list.
+ * heapFIT_POLICY_FIRST, the default, takes the first block that fits, starting
+ * from the lowest address.  heapFIT_POLICY_NEXT starts where the last search
+ * stopped, so small slivers do not collect at the bottom of the heap and get
+ * passed over by every search.  heapFIT_POLICY_BEST takes the smallest block
+ * that fits, but stops at the first block that is no more than
+ * 1 / ( 1 << configHEAP_BEST_FIT_BUCKET_SHIFT ) bigger than the request.
+ *
+ * pvPortMallocAligned() looks for a free block that can hold the request at the
+ * wanted alignment, and gives the space in front of it back to the free list
+ * as a block of its own, so nothing is lost to the alignment once it is freed.
+ *
+ * pvPortRealloc() resizes a block in place where it can - shrinking it by
+ * splitting its tail off onto the free list, or growing it into the block
+ * physically above it if that one is free - and only otherwise moves it.
+ *
+ * The heap is a single array, so pvPortMallocCaps() can only check the
+ * requested portMALLOC_CAP_ flags against configHEAP_CAPS, which describes the
+ * memory ucHeap has been placed in.
+ *
  * See heap_1.c, heap_2.c and heap_3.c for alternative implementations, and the
  * memory management pages of http://www.FreeRTOS.org for more information.
  */
 #include <stdlib.h>
+#include <string.h>
 
 /* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
 all the API functions to use the MPU wrappers.  That should only be done when
@@ -55,6 +85,51 @@ task.h is included from an application file. */
 /* Assumes 8bit bytes! */
 #define heapBITS_PER_BYTE		( ( size_t ) 8 )
 
+#ifndef configHEAP_USE_BOUNDARY_TAGS
+	#define configHEAP_USE_BOUNDARY_TAGS	0
+#endif
+
+#ifndef configHEAP_CAPS
+	#define configHEAP_CAPS	0
+#endif
+
+/* The values configHEAP_FIT_POLICY can take. */
+#define heapFIT_POLICY_FIRST	0
+#define heapFIT_POLICY_NEXT		1
+#define heapFIT_POLICY_BEST		2
+
+#ifndef configHEAP_FIT_POLICY
+	#define configHEAP_FIT_POLICY	heapFIT_POLICY_FIRST
+#endif
+
+#ifndef configHEAP_BEST_FIT_BUCKET_SHIFT
+	#define configHEAP_BEST_FIT_BUCKET_SHIFT	3
+#endif
+
+#if( configHEAP_FIT_POLICY != heapFIT_POLICY_FIRST ) && ( configHEAP_FIT_POLICY != heapFIT_POLICY_NEXT ) && ( configHEAP_FIT_POLICY != heapFIT_POLICY_BEST )
+	#error configHEAP_FIT_POLICY must be heapFIT_POLICY_FIRST, heapFIT_POLICY_NEXT or heapFIT_POLICY_BEST
+#endif
+
+#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+
+	/* Set in the xBlockSize member of a block whose lower neighbour is free.
+	Free blocks never have it set, as two free neighbours are always merged. */
+	#define heapPREV_FREE_BIT		( xBlockAllocatedBit >> 1 )
+
+	/* The flags that can be set in xBlockSize. */
+	#define heapBLOCK_FLAGS			( xBlockAllocatedBit | heapPREV_FREE_BIT )
+
+	/* A free block holds a link back to the previous free block straight after
+	its BlockLink_t, and its own size in its last word. */
+	#define heapPREV_FREE_LINK( pxBlock )	( *( BlockLink_t ** ) ( void * ) ( ( ( uint8_t * ) ( pxBlock ) ) + xHeapStructSize ) )
+	#define heapFOOTER( pxBlock, xSize )	( *( size_t * ) ( void * ) ( ( ( uint8_t * ) ( pxBlock ) ) + ( xSize ) - sizeof( size_t ) ) )
+
+#else
+
+	#define heapBLOCK_FLAGS			xBlockAllocatedBit
+
+#endif /* configHEAP_USE_BOUNDARY_TAGS */
+
 /* Allocate the memory for the heap. */
 #if( configAPPLICATION_ALLOCATED_HEAP == 1 )
 	/* The application writer has already defined the array used for the RTOS
@@ -82,12 +157,34 @@ typedef struct A_BLOCK_LINK
  */
 static void prvInsertBlockIntoFreeList( BlockLink_t *pxBlockToInsert );
 
+#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+
+	/*
+	 * Takes a free block out of the free list, using its back link.
+	 */
+	static void prvRemoveBlockFromFreeList( BlockLink_t *pxBlockToRemove );
+
+#endif
+
 /*
  * Called automatically to setup the required heap structures the first time
  * pvPortMalloc() is called.
  */
 static void prvHeapInit( void );
 
+/*
+ * Searches the free list for a block of at least xWantedSize bytes, following
+ * configHEAP_FIT_POLICY.  Returns pxEnd if there is none, otherwise the block,
+ * with the block in front of it in the list written to *ppxPreviousBlock.
+ */
+static BlockLink_t *prvFindFreeBlock( size_t xWantedSize, BlockLink_t **ppxPreviousBlock );
+
+/*
+ * Takes pxBlock, which is free, off the free list.  pxPreviousBlock is the
+ * block in front of it in the list.
+ */
+static void prvUnlinkFreeBlock( BlockLink_t *pxBlock, BlockLink_t *pxPreviousBlock );
+
 /*-----------------------------------------------------------*/
 
 /* The size of the structure placed at the beginning of each allocated memory
@@ -97,6 +194,14 @@ static const size_t xHeapStructSize	= ( sizeof( BlockLink_t ) + ( ( size_t ) ( p
 /* Create a couple of list links to mark the start and end of the list. */
 static BlockLink_t xStart, *pxEnd = NULL;
 
+#if( configHEAP_FIT_POLICY == heapFIT_POLICY_NEXT )
+
+	/* The free block in front of where the next search starts.  Always on the
+	free list, or &xStart. */
+	static BlockLink_t *pxRover = &xStart;
+
+#endif
+
 /* Keeps track of the number of free bytes remaining, but says nothing about
 fragmentation. */
 static size_t xFreeBytesRemaining = 0U;
@@ -114,9 +219,14 @@ void *pvPortMalloc( size_t xWantedSize )
 {
 BlockLink_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
 void *pvReturn = NULL;
+#if( configHEAP_USE_TRACE == 1 ) || ( configHEAP_USE_GUARDS == 1 ) || ( configHEAP_USE_RECLAIM == 1 )
+	const size_t xRequestedSize = xWantedSize;
+#endif
 
 	vTaskSuspendAll();
 	{
+		portHEAP_TIMING_START( portHEAP_TIMING_MALLOC );
+
 		/* If this is the first call to malloc then the heap will require
 		initialisation to setup the list of free blocks. */
 		if( pxEnd == NULL )
@@ -132,13 +242,14 @@ void *pvReturn = NULL;
 		set.  The top bit of the block size member of the BlockLink_t structure
 		is used to determine who owns the block - the application or the
 		kernel, so it must be free. */
-		if( ( xWantedSize & xBlockAllocatedBit ) == 0 )
+		if( ( xWantedSize & heapBLOCK_FLAGS ) == 0 )
 		{
 			/* The wanted size is increased so it can contain a BlockLink_t
-			structure in addition to the requested amount of bytes. */
+			structure, and any red zone, in addition to the requested amount
+			of bytes. */
 			if( xWantedSize > 0 )
 			{
-				xWantedSize += xHeapStructSize;
+				xWantedSize += xHeapStructSize + portHEAP_GUARD_OVERHEAD;
 
 				/* Ensure that blocks are always aligned to the required number
 				of bytes. */
@@ -151,6 +262,21 @@ void *pvReturn = NULL;
 				{
 					mtCOVERAGE_TEST_MARKER();
 				}
+
+				#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+				{
+					/* Once freed the block has to hold its back link and
+					footer. */
+					if( xWantedSize < heapMINIMUM_BLOCK_SIZE )
+					{
+						xWantedSize = heapMINIMUM_BLOCK_SIZE;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+				#endif
 			}
 			else
 			{
@@ -159,15 +285,7 @@ void *pvReturn = NULL;
 
 			if( ( xWantedSize > 0 ) && ( xWantedSize <= xFreeBytesRemaining ) )
 			{
-				/* Traverse the list from the start	(lowest address) block until
-				one	of adequate size is found. */
-				pxPreviousBlock = &xStart;
-				pxBlock = xStart.pxNextFreeBlock;
-				while( ( pxBlock->xBlockSize < xWantedSize ) && ( pxBlock->pxNextFreeBlock != NULL ) )
-				{
-					pxPreviousBlock = pxBlock;
-					pxBlock = pxBlock->pxNextFreeBlock;
-				}
+				pxBlock = prvFindFreeBlock( xWantedSize, &pxPreviousBlock );
 
 				/* If the end marker was reached then a block of adequate size
 				was	not found. */
@@ -181,6 +299,19 @@ void *pvReturn = NULL;
 					of the list of free blocks. */
 					pxPreviousBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
 
+					#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+					{
+						if( pxBlock->pxNextFreeBlock != pxEnd )
+						{
+							heapPREV_FREE_LINK( pxBlock->pxNextFreeBlock ) = pxPreviousBlock;
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
+					}
+					#endif
+
 					/* If the block is larger than required it can be split into
 					two. */
 					if( ( pxBlock->xBlockSize - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
@@ -206,6 +337,35 @@ void *pvReturn = NULL;
 
 					xFreeBytesRemaining -= pxBlock->xBlockSize;
 
+					if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+					{
+						xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+
+					portHEAP_TAG_RECORD( pvReturn, pxBlock->xBlockSize );
+					portHEAP_GUARD_ARM( pvReturn, xRequestedSize, ( pxBlock->xBlockSize & ~heapBLOCK_FLAGS ) - xHeapStructSize );
+
+					#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+					{
+						/* The block above no longer has a free neighbour below
+						it, unless that neighbour is the remainder split off
+						above, which never has the bit set. */
+						pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + pxBlock->xBlockSize );
+						if( pxNewBlockLink != pxEnd )
+						{
+							pxNewBlockLink->xBlockSize &= ~heapPREV_FREE_BIT;
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
+					}
+					#endif
+
 					/* The block is being returned - it is allocated and owned
 					by the application and has no "next" block. */
 					pxBlock->xBlockSize |= xBlockAllocatedBit;
@@ -225,9 +385,34 @@ void *pvReturn = NULL;
 		{
 			mtCOVERAGE_TEST_MARKER();
 		}
+
+		portHEAP_TIMING_STOP( portHEAP_TIMING_MALLOC );
 	}
 	( void ) xTaskResumeAll();
 
+	portHEAP_TRACE_MALLOC( pvReturn, xRequestedSize );
+
+	#if( configHEAP_USE_RECLAIM == 1 )
+	{
+		if( pvReturn != NULL )
+		{
+			vPortHeapReclaimCheck( portHEAP_RECLAIM_HEAP, xFreeBytesRemaining );
+		}
+		else if( ( xRequestedSize > 0 ) && ( xPortHeapReclaimBegin( portHEAP_RECLAIM_HEAP ) == pdTRUE ) )
+		{
+			/* The callbacks may have freed enough, so try once more.  The
+			retry calls the malloc failed hook if it fails too. */
+			pvReturn = pvPortMalloc( xRequestedSize );
+			vPortHeapReclaimEnd();
+			return pvReturn;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
 	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
 	{
 		if( pvReturn == NULL )
@@ -260,6 +445,18 @@ BlockLink_t *pxLink;
 		/* This casting is to keep the compiler from issuing warnings. */
 		pxLink = ( void * ) puc;
 
+		#if( configHEAP_USE_GUARDS == 1 )
+		{
+			if( ( ( pxLink->xBlockSize & xBlockAllocatedBit ) == 0 ) || ( pxLink->pxNextFreeBlock != NULL ) ||
+				( ( ( pxLink->xBlockSize & ~heapBLOCK_FLAGS ) - xHeapStructSize ) > configTOTAL_HEAP_SIZE ) ||
+				( xPortHeapGuardCheck( pv, ( pxLink->xBlockSize & ~heapBLOCK_FLAGS ) - xHeapStructSize ) == pdFALSE ) )
+			{
+				configHEAP_GUARD_FAILED( pv );
+				return;
+			}
+		}
+		#endif
+
 		if( ( pxLink->xBlockSize & xBlockAllocatedBit ) != 0 )
 		{
 			if( pxLink->pxNextFreeBlock == NULL )
@@ -270,9 +467,17 @@ BlockLink_t *pxLink;
 
 				vTaskSuspendAll();
 				{
+					portHEAP_TIMING_START( portHEAP_TIMING_FREE );
+
+					portHEAP_TAG_FORGET( pv );
+					portHEAP_TRACE_FREE( pv );
+					portHEAP_GUARD_POISON( pv, ( pxLink->xBlockSize & ~heapBLOCK_FLAGS ) - xHeapStructSize );
+
 					/* Add this block to the list of free blocks. */
-					xFreeBytesRemaining += pxLink->xBlockSize;
+					xFreeBytesRemaining += ( pxLink->xBlockSize & ~heapBLOCK_FLAGS );
 					prvInsertBlockIntoFreeList( ( ( BlockLink_t * ) pxLink ) );
+
+					portHEAP_TIMING_STOP( portHEAP_TIMING_FREE );
 				}
 				( void ) xTaskResumeAll();
 			}
@@ -289,6 +494,402 @@ BlockLink_t *pxLink;
 }
 /*-----------------------------------------------------------*/
 
+void *pvPortMallocAligned( size_t xWantedSize, size_t xAlignment )
+{
+BlockLink_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
+void *pvReturn = NULL;
+size_t uxAddress, xLead = 0, xBlockSize, xFlags;
+#if( configHEAP_USE_TRACE == 1 ) || ( configHEAP_USE_GUARDS == 1 )
+	const size_t xRequestedSize = xWantedSize;
+#endif
+
+	/* The alignment must be a power of two. */
+	configASSERT( ( xAlignment & ( xAlignment - 1 ) ) == 0 );
+
+	if( ( xAlignment <= portBYTE_ALIGNMENT ) || ( ( xAlignment & ( xAlignment - 1 ) ) != 0 ) )
+	{
+		/* Every block is already aligned this well. */
+		return ( ( xAlignment & ( xAlignment - 1 ) ) == 0 ) ? pvPortMalloc( xWantedSize ) : NULL;
+	}
+
+	vTaskSuspendAll();
+	{
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		/* Size the block exactly as pvPortMalloc() would.  The checks against
+		xFreeBytesRemaining also keep the sums below from overflowing. */
+		if( ( xWantedSize > 0 ) && ( xWantedSize < xFreeBytesRemaining ) && ( xAlignment < xFreeBytesRemaining ) )
+		{
+			xWantedSize += xHeapStructSize + portHEAP_GUARD_OVERHEAD;
+
+			if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0x00 )
+			{
+				xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			if( xWantedSize < heapMINIMUM_BLOCK_SIZE )
+			{
+				xWantedSize = heapMINIMUM_BLOCK_SIZE;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			/* Walk the free list, in whatever order it is kept, for the first
+			block that still holds xWantedSize bytes once the space in front
+			of the first aligned address in it is split off.  That space must
+			be either nothing or big enough to be a free block itself. */
+			pxPreviousBlock = &xStart;
+			for( pxBlock = xStart.pxNextFreeBlock; pxBlock != pxEnd; pxBlock = pxBlock->pxNextFreeBlock )
+			{
+				uxAddress = ( ( size_t ) pxBlock ) + xHeapStructSize;
+				uxAddress = ( uxAddress + ( xAlignment - 1 ) ) & ~( xAlignment - 1 );
+				xLead = uxAddress - xHeapStructSize - ( size_t ) pxBlock;
+
+				if( ( xLead != 0 ) && ( xLead < heapMINIMUM_BLOCK_SIZE ) )
+				{
+					xLead += ( ( heapMINIMUM_BLOCK_SIZE - xLead ) + ( xAlignment - 1 ) ) & ~( xAlignment - 1 );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				if( ( pxBlock->xBlockSize > xLead ) && ( ( pxBlock->xBlockSize - xLead ) >= xWantedSize ) )
+				{
+					break;
+				}
+
+				pxPreviousBlock = pxBlock;
+			}
+
+			if( pxBlock != pxEnd )
+			{
+				prvUnlinkFreeBlock( pxBlock, pxPreviousBlock );
+
+				if( xLead != 0 )
+				{
+					/* The space in front becomes a free block of its own.  The
+					aligned block is marked as allocated first so the insert
+					does not merge the two straight back together. */
+					pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xLead );
+					pxNewBlockLink->xBlockSize = ( pxBlock->xBlockSize - xLead ) | xBlockAllocatedBit;
+					pxBlock->xBlockSize = xLead;
+					prvInsertBlockIntoFreeList( pxBlock );
+					pxBlock = pxNewBlockLink;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* With boundary tags the insert above told the aligned block
+				that its lower neighbour is free. */
+				xFlags = pxBlock->xBlockSize & ( heapBLOCK_FLAGS & ~xBlockAllocatedBit );
+				xBlockSize = pxBlock->xBlockSize & ~heapBLOCK_FLAGS;
+
+				/* Split the tail off just as pvPortMalloc() does. */
+				if( ( xBlockSize - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
+				{
+					pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+					pxNewBlockLink->xBlockSize = xBlockSize - xWantedSize;
+					xBlockSize = xWantedSize;
+					pxBlock->xBlockSize = xBlockSize | xBlockAllocatedBit | xFlags;
+					prvInsertBlockIntoFreeList( pxNewBlockLink );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				xFreeBytesRemaining -= xBlockSize;
+
+				if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+				{
+					xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+				{
+					pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xBlockSize );
+					if( pxNewBlockLink != pxEnd )
+					{
+						pxNewBlockLink->xBlockSize &= ~heapPREV_FREE_BIT;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+				#endif
+
+				pxBlock->xBlockSize = xBlockSize | xBlockAllocatedBit | xFlags;
+				pxBlock->pxNextFreeBlock = NULL;
+
+				pvReturn = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xHeapStructSize );
+				portHEAP_TAG_RECORD( pvReturn, xBlockSize );
+				portHEAP_GUARD_ARM( pvReturn, xRequestedSize, xBlockSize - xHeapStructSize );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	portHEAP_TRACE_MALLOC( pvReturn, xRequestedSize );
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortRealloc( void *pv, size_t xWantedSize )
+{
+BlockLink_t *pxLink, *pxNext, *pxPreviousBlock, *pxNewBlockLink;
+void *pvReturn = NULL;
+size_t xBlockSize, xFlags, xNewSize;
+
+	if( pv == NULL )
+	{
+		return pvPortMalloc( xWantedSize );
+	}
+
+	if( xWantedSize == 0 )
+	{
+		vPortFree( pv );
+		return NULL;
+	}
+
+	pxLink = ( void * ) ( ( ( uint8_t * ) pv ) - xHeapStructSize );
+	configASSERT( ( pxLink->xBlockSize & xBlockAllocatedBit ) != 0 );
+	configASSERT( pxLink->pxNextFreeBlock == NULL );
+
+	#if( configHEAP_USE_GUARDS == 1 )
+	{
+		/* A damaged block is left as it is, as vPortFree() would. */
+		if( ( ( pxLink->xBlockSize & xBlockAllocatedBit ) == 0 ) || ( pxLink->pxNextFreeBlock != NULL ) ||
+			( ( ( pxLink->xBlockSize & ~heapBLOCK_FLAGS ) - xHeapStructSize ) > configTOTAL_HEAP_SIZE ) ||
+			( xPortHeapGuardCheck( pv, ( pxLink->xBlockSize & ~heapBLOCK_FLAGS ) - xHeapStructSize ) == pdFALSE ) )
+		{
+			configHEAP_GUARD_FAILED( pv );
+			return NULL;
+		}
+	}
+	#endif
+
+	/* Size the block exactly as pvPortMalloc() would. */
+	if( ( xWantedSize & heapBLOCK_FLAGS ) == 0 )
+	{
+		xNewSize = xWantedSize + xHeapStructSize + portHEAP_GUARD_OVERHEAD;
+
+		if( ( xNewSize & portBYTE_ALIGNMENT_MASK ) != 0x00 )
+		{
+			xNewSize += ( portBYTE_ALIGNMENT - ( xNewSize & portBYTE_ALIGNMENT_MASK ) );
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		if( xNewSize < heapMINIMUM_BLOCK_SIZE )
+		{
+			xNewSize = heapMINIMUM_BLOCK_SIZE;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		vTaskSuspendAll();
+		{
+			xFlags = pxLink->xBlockSize & ( heapBLOCK_FLAGS & ~xBlockAllocatedBit );
+			xBlockSize = pxLink->xBlockSize & ~heapBLOCK_FLAGS;
+
+			if( xNewSize > xBlockSize )
+			{
+				/* Can the block above make up the difference?  pxEnd has a
+				size of 0 and the allocated bit clear, so is skipped. */
+				pxNext = ( void * ) ( ( ( uint8_t * ) pxLink ) + xBlockSize );
+
+				if( ( pxNext != pxEnd ) && ( ( pxNext->xBlockSize & xBlockAllocatedBit ) == 0 ) && ( ( xBlockSize + pxNext->xBlockSize ) >= xNewSize ) )
+				{
+					#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+					{
+						pxPreviousBlock = NULL;
+					}
+					#else
+					{
+						/* The list is in address order, so the block in front
+						of pxNext is found by walking it. */
+						for( pxPreviousBlock = &xStart; pxPreviousBlock->pxNextFreeBlock != pxNext; pxPreviousBlock = pxPreviousBlock->pxNextFreeBlock )
+						{
+							/* There is nothing to do here. */
+						}
+					}
+					#endif
+
+					prvUnlinkFreeBlock( pxNext, pxPreviousBlock );
+					xFreeBytesRemaining -= pxNext->xBlockSize;
+					xBlockSize += pxNext->xBlockSize;
+
+					#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+					{
+						/* The block above is no longer above a free block.  If
+						a tail is split off below it is told again. */
+						pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxLink ) + xBlockSize );
+						if( pxNewBlockLink != pxEnd )
+						{
+							pxNewBlockLink->xBlockSize &= ~heapPREV_FREE_BIT;
+						}
+						else
+						{
+							mtCOVERAGE_TEST_MARKER();
+						}
+					}
+					#endif
+
+					pvReturn = pv;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				/* Shrinking, or the block is already big enough. */
+				pvReturn = pv;
+			}
+
+			if( pvReturn != NULL )
+			{
+				/* Give any tail that is worth keeping back to the free list,
+				just as pvPortMalloc() does when it splits a block. */
+				if( ( xBlockSize - xNewSize ) > heapMINIMUM_BLOCK_SIZE )
+				{
+					pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxLink ) + xNewSize );
+					pxNewBlockLink->xBlockSize = xBlockSize - xNewSize;
+					xFreeBytesRemaining += pxNewBlockLink->xBlockSize;
+					xBlockSize = xNewSize;
+					prvInsertBlockIntoFreeList( pxNewBlockLink );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* Only a block that grew can have taken the free bytes lower,
+				and only once the tail is back is it known by how much. */
+				if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+				{
+					xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				pxLink->xBlockSize = xBlockSize | xBlockAllocatedBit | xFlags;
+				portHEAP_TAG_RESIZE( pv, xBlockSize );
+				portHEAP_GUARD_ARM( pv, xWantedSize, xBlockSize - xHeapStructSize );
+				portHEAP_TRACE_REALLOC( pv, xWantedSize );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		( void ) xTaskResumeAll();
+
+		if( pvReturn == NULL )
+		{
+			/* The block has to move. */
+			pvReturn = pvPortMalloc( xWantedSize );
+
+			if( pvReturn != NULL )
+			{
+				/* The block only moves to grow, so everything before its red
+				zone fits in front of the new one. */
+				memcpy( pvReturn, pv, xBlockSize - xHeapStructSize - portHEAP_GUARD_OVERHEAD );
+				vPortFree( pv );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMallocCaps( size_t xWantedSize, uint32_t ulCaps )
+{
+void *pvReturn = NULL;
+
+	if( ( ulCaps & ~( ( uint32_t ) configHEAP_CAPS ) ) == 0 )
+	{
+		pvReturn = pvPortMalloc( xWantedSize );
+	}
+	else
+	{
+		/* No memory in this heap has the requested caps. */
+		#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+		#endif
+	}
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
 size_t xPortGetFreeHeapSize( void )
 {
 	return xFreeBytesRemaining;
@@ -307,6 +908,123 @@ void vPortInitialiseBlocks( void )
 }
 /*-----------------------------------------------------------*/
 
+#if( configHEAP_FIT_POLICY == heapFIT_POLICY_FIRST )
+
+static BlockLink_t *prvFindFreeBlock( size_t xWantedSize, BlockLink_t **ppxPreviousBlock )
+{
+BlockLink_t *pxBlock, *pxPreviousBlock;
+
+	/* Traverse the list from the start	(lowest address) block until one of
+	adequate size is found. */
+	pxPreviousBlock = &xStart;
+	pxBlock = xStart.pxNextFreeBlock;
+	while( ( pxBlock->xBlockSize < xWantedSize ) && ( pxBlock->pxNextFreeBlock != NULL ) )
+	{
+		pxPreviousBlock = pxBlock;
+		pxBlock = pxBlock->pxNextFreeBlock;
+	}
+
+	*ppxPreviousBlock = pxPreviousBlock;
+	return pxBlock;
+}
+
+#elif( configHEAP_FIT_POLICY == heapFIT_POLICY_NEXT )
+
+static BlockLink_t *prvFindFreeBlock( size_t xWantedSize, BlockLink_t **ppxPreviousBlock )
+{
+BlockLink_t *pxBlock, *pxPreviousBlock;
+BaseType_t xWrapped;
+
+	/* Start after the rover and wrap around to the bottom of the heap once,
+	stopping after the rover itself has been looked at.  A search that starts
+	from xStart covers the whole list without wrapping. */
+	pxPreviousBlock = pxRover;
+	pxBlock = pxRover->pxNextFreeBlock;
+	xWrapped = ( pxRover == &xStart ) ? pdTRUE : pdFALSE;
+
+	while( pxBlock->xBlockSize < xWantedSize )
+	{
+		if( pxBlock == pxEnd )
+		{
+			if( xWrapped != pdFALSE )
+			{
+				break;
+			}
+
+			xWrapped = pdTRUE;
+			pxPreviousBlock = &xStart;
+			pxBlock = xStart.pxNextFreeBlock;
+		}
+		else if( ( xWrapped != pdFALSE ) && ( pxBlock == pxRover ) )
+		{
+			pxBlock = pxEnd;
+			break;
+		}
+		else
+		{
+			pxPreviousBlock = pxBlock;
+			pxBlock = pxBlock->pxNextFreeBlock;
+		}
+	}
+
+	if( pxBlock != pxEnd )
+	{
+		/* pxPreviousBlock stays on the list when pxBlock is taken off it. */
+		pxRover = pxPreviousBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	*ppxPreviousBlock = pxPreviousBlock;
+	return pxBlock;
+}
+
+#elif( configHEAP_FIT_POLICY == heapFIT_POLICY_BEST )
+
+static BlockLink_t *prvFindFreeBlock( size_t xWantedSize, BlockLink_t **ppxPreviousBlock )
+{
+BlockLink_t *pxBlock, *pxPreviousBlock, *pxBest = pxEnd;
+const size_t xGoodEnough = xWantedSize + ( xWantedSize >> configHEAP_BEST_FIT_BUCKET_SHIFT );
+
+	*ppxPreviousBlock = &xStart;
+	pxPreviousBlock = &xStart;
+	pxBlock = xStart.pxNextFreeBlock;
+
+	while( pxBlock != pxEnd )
+	{
+		if( ( pxBlock->xBlockSize >= xWantedSize ) && ( ( pxBest == pxEnd ) || ( pxBlock->xBlockSize < pxBest->xBlockSize ) ) )
+		{
+			pxBest = pxBlock;
+			*ppxPreviousBlock = pxPreviousBlock;
+
+			/* A block this close to the request will not be beaten by
+			enough to be worth the rest of the walk. */
+			if( pxBlock->xBlockSize <= xGoodEnough )
+			{
+				break;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		pxPreviousBlock = pxBlock;
+		pxBlock = pxBlock->pxNextFreeBlock;
+	}
+
+	return pxBest;
+}
+
+#endif /* configHEAP_FIT_POLICY */
+/*-----------------------------------------------------------*/
+
 static void prvHeapInit( void )
 {
 BlockLink_t *pxFirstFreeBlock;
@@ -352,14 +1070,119 @@ size_t xTotalHeapSize = configTOTAL_HEAP_SIZE;
 
 	/* Work out the position of the top bit in a size_t variable. */
 	xBlockAllocatedBit = ( ( size_t ) 1 ) << ( ( sizeof( size_t ) * heapBITS_PER_BYTE ) - 1 );
+
+	#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+	{
+		heapPREV_FREE_LINK( pxFirstFreeBlock ) = &xStart;
+		heapFOOTER( pxFirstFreeBlock, pxFirstFreeBlock->xBlockSize ) = pxFirstFreeBlock->xBlockSize;
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+
+static void prvInsertBlockIntoFreeList( BlockLink_t *pxBlockToInsert )
+{
+BlockLink_t *pxNeighbour;
+size_t xSize = pxBlockToInsert->xBlockSize & ~heapBLOCK_FLAGS;
+
+	portHEAP_TIMING_START( portHEAP_TIMING_INSERT );
+
+	/* Is the block above free?  pxEnd has no footer and is never merged. */
+	pxNeighbour = ( void * ) ( ( ( uint8_t * ) pxBlockToInsert ) + xSize );
+	if( ( pxNeighbour != pxEnd ) && ( ( pxNeighbour->xBlockSize & xBlockAllocatedBit ) == 0 ) )
+	{
+		prvRemoveBlockFromFreeList( pxNeighbour );
+		xSize += pxNeighbour->xBlockSize;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	/* Is the block below free?  If so its footer says where it starts. */
+	if( ( pxBlockToInsert->xBlockSize & heapPREV_FREE_BIT ) != 0 )
+	{
+		pxNeighbour = ( void * ) ( ( ( uint8_t * ) pxBlockToInsert ) - *( ( size_t * ) ( void * ) pxBlockToInsert - 1 ) );
+		prvRemoveBlockFromFreeList( pxNeighbour );
+		xSize += pxNeighbour->xBlockSize;
+		pxBlockToInsert = pxNeighbour;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	pxBlockToInsert->xBlockSize = xSize;
+	heapFOOTER( pxBlockToInsert, xSize ) = xSize;
+
+	/* Tell the block above that its lower neighbour is now free. */
+	pxNeighbour = ( void * ) ( ( ( uint8_t * ) pxBlockToInsert ) + xSize );
+	if( pxNeighbour != pxEnd )
+	{
+		pxNeighbour->xBlockSize |= heapPREV_FREE_BIT;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	/* Push the block onto the front of the list.  pxEnd always stays last. */
+	pxBlockToInsert->pxNextFreeBlock = xStart.pxNextFreeBlock;
+	heapPREV_FREE_LINK( pxBlockToInsert ) = &xStart;
+	if( xStart.pxNextFreeBlock != pxEnd )
+	{
+		heapPREV_FREE_LINK( xStart.pxNextFreeBlock ) = pxBlockToInsert;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+	xStart.pxNextFreeBlock = pxBlockToInsert;
+
+	portHEAP_TIMING_STOP( portHEAP_TIMING_INSERT );
 }
 /*-----------------------------------------------------------*/
 
+static void prvRemoveBlockFromFreeList( BlockLink_t *pxBlockToRemove )
+{
+BlockLink_t *pxPrevious = heapPREV_FREE_LINK( pxBlockToRemove );
+
+	pxPrevious->pxNextFreeBlock = pxBlockToRemove->pxNextFreeBlock;
+
+	#if( configHEAP_FIT_POLICY == heapFIT_POLICY_NEXT )
+	{
+		if( pxRover == pxBlockToRemove )
+		{
+			pxRover = pxPrevious;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
+	if( pxBlockToRemove->pxNextFreeBlock != pxEnd )
+	{
+		heapPREV_FREE_LINK( pxBlockToRemove->pxNextFreeBlock ) = pxPrevious;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+}
+
+#else /* configHEAP_USE_BOUNDARY_TAGS */
+
 static void prvInsertBlockIntoFreeList( BlockLink_t *pxBlockToInsert )
 {
 BlockLink_t *pxIterator;
 uint8_t *puc;
 
+	portHEAP_TIMING_START( portHEAP_TIMING_INSERT );
+
 	/* Iterate through the list until a block is found that has a higher address
 	than the block being inserted. */
 	for( pxIterator = &xStart; pxIterator->pxNextFreeBlock < pxBlockToInsert; pxIterator = pxIterator->pxNextFreeBlock )
@@ -387,6 +1210,20 @@ uint8_t *puc;
 	{
 		if( pxIterator->pxNextFreeBlock != pxEnd )
 		{
+			#if( configHEAP_FIT_POLICY == heapFIT_POLICY_NEXT )
+			{
+				/* The block above is about to stop existing on its own. */
+				if( pxRover == pxIterator->pxNextFreeBlock )
+				{
+					pxRover = pxBlockToInsert;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			#endif
+
 			/* Form one big block from the two blocks. */
 			pxBlockToInsert->xBlockSize += pxIterator->pxNextFreeBlock->xBlockSize;
 			pxBlockToInsert->pxNextFreeBlock = pxIterator->pxNextFreeBlock->pxNextFreeBlock;
@@ -413,5 +1250,37 @@ uint8_t *puc;
 	{
 		mtCOVERAGE_TEST_MARKER();
 	}
+
+	portHEAP_TIMING_STOP( portHEAP_TIMING_INSERT );
 }
 
+#endif /* configHEAP_USE_BOUNDARY_TAGS */
+
+static void prvUnlinkFreeBlock( BlockLink_t *pxBlock, BlockLink_t *pxPreviousBlock )
+{
+	#if( configHEAP_USE_BOUNDARY_TAGS == 1 )
+	{
+		/* The back link already names pxPreviousBlock. */
+		( void ) pxPreviousBlock;
+		prvRemoveBlockFromFreeList( pxBlock );
+	}
+	#else
+	{
+		pxPreviousBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+
+		#if( configHEAP_FIT_POLICY == heapFIT_POLICY_NEXT )
+		{
+			if( pxRover == pxBlock )
+			{
+				pxRover = pxPreviousBlock;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		#endif
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
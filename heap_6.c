@@ -0,0 +1,666 @@
+/*
+ * FreeRTOS Kernel V10.2.1
+ * Copyright (C) 2019 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * A sample implementation of pvPortMalloc() and vPortFree() that, like
+ * heap_4.c, combines adjacent memory blocks as they are freed, but does so in
+ * constant time.
+ *
+ * Free blocks are kept in a two level segregated fit (TLSF) index.  The first
+ * level splits sizes into powers of two, and the second level splits each power
+ * of two into heapSL_COUNT equal ranges.  A bitmap at each level records which
+ * lists are not empty, so the list to allocate from is found with a couple of
+ * bit scans whatever the state of the heap.  Every block records the address of
+ * the block physically before it, so vPortFree() finds both neighbours without
+ * walking any list.  pvPortMalloc() and vPortFree() therefore have a bounded
+ * execution time that does not grow with fragmentation.
+ *
+ * The price is a slightly larger block header than heap_4.c, and requests are
+ * rounded up to the bottom of the next second level range before the search,
+ * so a request may fail while a block from the bottom of its own range that
+ * would fit is free.  Only the head of that range's list is checked as a last
+ * resort.
+ *
+ * See heap_1.c, heap_2.c, heap_3.c and heap_4.c for alternative
+ * implementations, and the memory management pages of http://www.FreeRTOS.org
+ * for more information.
+ */
+#include <stdlib.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configSUPPORT_DYNAMIC_ALLOCATION == 0 )
+	#error This file must not be used if configSUPPORT_DYNAMIC_ALLOCATION is 0
+#endif
+
+/* The number of second level lists per power of two is 1 << this value. */
+#ifndef configHEAP_TLSF_SL_BITS
+	#define configHEAP_TLSF_SL_BITS		3
+#endif
+
+/* The number of first level lists.  The heap must be smaller than
+heapSMALL_BLOCK_SIZE << ( configHEAP_TLSF_FL_COUNT - 1 ) bytes. */
+#ifndef configHEAP_TLSF_FL_COUNT
+	#define configHEAP_TLSF_FL_COUNT	16
+#endif
+
+#define heapSL_COUNT			( 1UL << configHEAP_TLSF_SL_BITS )
+
+/* Blocks below this size all share first level list 0, and its second level
+lists are portBYTE_ALIGNMENT bytes apart. */
+#define heapSMALL_BLOCK_SIZE	( heapSL_COUNT * portBYTE_ALIGNMENT )
+
+#if( configHEAP_TLSF_SL_BITS < 1 ) || ( configHEAP_TLSF_SL_BITS > 5 )
+	#error configHEAP_TLSF_SL_BITS must be between 1 and 5
+#endif
+
+#if( configHEAP_TLSF_FL_COUNT > 31 )
+	#error configHEAP_TLSF_FL_COUNT must be at most 31
+#endif
+
+/* configTOTAL_HEAP_SIZE must be less than heapSMALL_BLOCK_SIZE <<
+( configHEAP_TLSF_FL_COUNT - 1 ).  It is often defined with a cast, so the
+preprocessor can not test it, and it is shifted down rather than the limit up
+so nothing can overflow. */
+typedef char heapTOTAL_HEAP_SIZE_FITS_FL_COUNT_t[ ( ( ( size_t ) configTOTAL_HEAP_SIZE >> ( configHEAP_TLSF_FL_COUNT - 1 ) ) < heapSMALL_BLOCK_SIZE ) ? 1 : -1 ];
+
+/* Set in the xBlockSize member of a block that is on a free list.  Block sizes
+are always a multiple of portBYTE_ALIGNMENT, so the bit is otherwise unused. */
+#define heapBLOCK_FREE_BIT		( ( size_t ) 1 )
+#define heapBLOCK_SIZE( pxBlock )	( ( pxBlock )->xBlockSize & ~heapBLOCK_FREE_BIT )
+#define heapBLOCK_IS_FREE( pxBlock )	( ( ( pxBlock )->xBlockSize & heapBLOCK_FREE_BIT ) != 0 )
+
+/* The block physically after pxBlock. */
+#define heapNEXT_PHYSICAL( pxBlock )	( ( BlockLink_t * ) ( void * ) ( ( ( uint8_t * ) ( pxBlock ) ) + heapBLOCK_SIZE( pxBlock ) ) )
+
+/* Allocate the memory for the heap. */
+#if( configAPPLICATION_ALLOCATED_HEAP == 1 )
+	/* The application writer has already defined the array used for the RTOS
+	heap - probably so it can be placed in a special segment or address. */
+	extern uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#else
+	static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#endif /* configAPPLICATION_ALLOCATED_HEAP */
+
+/* The block header.  Only the first two members are kept while a block is
+allocated - the free list links overlay the start of the application's data,
+so are only valid while the block is free. */
+typedef struct A_BLOCK_LINK
+{
+	struct A_BLOCK_LINK *pxPrevPhysicalBlock;	/*<< The block immediately below this one in memory, NULL for the first. */
+	size_t xBlockSize;							/*<< The size of the block, including its header, and heapBLOCK_FREE_BIT. */
+	struct A_BLOCK_LINK *pxNextFreeBlock;		/*<< The next block on the same free list. */
+	struct A_BLOCK_LINK *pxPrevFreeBlock;		/*<< The previous block on the same free list. */
+} BlockLink_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Called automatically to setup the required heap structures the first time
+ * pvPortMalloc() is called.
+ */
+static void prvHeapInit( void );
+
+/*
+ * Add a block to, or remove a block from, the free list that matches its size,
+ * keeping the bitmaps up to date.
+ */
+static void prvInsertFreeBlock( BlockLink_t *pxBlock );
+static void prvRemoveFreeBlock( BlockLink_t *pxBlock );
+
+/*
+ * Find the first and second level list that holds blocks of xSize bytes.
+ */
+static void prvMapSize( size_t xSize, UBaseType_t *puxFirst, UBaseType_t *puxSecond );
+
+/*
+ * Return the index of the most, or least, significant set bit of ulValue,
+ * which must not be 0.  Both take the same number of steps for any value.
+ */
+static UBaseType_t prvFindLastSet( uint32_t ulValue );
+#define heapFIND_FIRST_SET( ulValue )	prvFindLastSet( ( ulValue ) & ( ~( ulValue ) + 1UL ) )
+
+/*-----------------------------------------------------------*/
+
+/* The part of BlockLink_t that stays in front of an allocated block must be
+correctly byte aligned. */
+static const size_t xHeapStructSize	= ( ( 2 * sizeof( void * ) ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* A free block has to hold the whole of BlockLink_t. */
+static const size_t xMinimumBlockSize = ( sizeof( BlockLink_t ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* The heads of the free lists, and which of them are not empty.  Bit n of
+ulFirstLevelMap is set if any bit of ulSecondLevelMap[ n ] is set. */
+static BlockLink_t *pxFreeLists[ configHEAP_TLSF_FL_COUNT ][ heapSL_COUNT ];
+static uint32_t ulFirstLevelMap = 0;
+static uint32_t ulSecondLevelMap[ configHEAP_TLSF_FL_COUNT ];
+
+/* A zero sized allocated block at the top of the heap, which stops the block
+below it ever being merged upwards. */
+static BlockLink_t *pxEnd = NULL;
+
+/* The first level index of heapSMALL_BLOCK_SIZE, set by prvHeapInit(). */
+static UBaseType_t uxSmallBlockShift = 0;
+
+/* Keeps track of the number of free bytes remaining, but says nothing about
+fragmentation. */
+static size_t xFreeBytesRemaining = 0U;
+static size_t xMinimumEverFreeBytesRemaining = 0U;
+
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+BlockLink_t *pxBlock = NULL, *pxNewBlockLink;
+UBaseType_t uxFirst, uxSecond;
+uint32_t ulMap;
+void *pvReturn = NULL;
+#if( configHEAP_USE_TRACE == 1 ) || ( configHEAP_USE_GUARDS == 1 ) || ( configHEAP_USE_RECLAIM == 1 )
+	const size_t xRequestedSize = xWantedSize;
+#endif
+
+	vTaskSuspendAll();
+	{
+		portHEAP_TIMING_START( portHEAP_TIMING_MALLOC );
+
+		/* If this is the first call to malloc then the heap will require
+		initialisation to setup the list of free blocks. */
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		/* Requests larger than the heap are rejected before the size is
+		adjusted, so the adjustment can not overflow. */
+		if( ( xWantedSize > 0 ) && ( xWantedSize <= xFreeBytesRemaining ) )
+		{
+			/* The wanted size is increased so it can contain the block header
+			and any red zone in addition to the requested amount of bytes, and
+			so the block can hold the free list links once it is freed. */
+			xWantedSize += xHeapStructSize + portHEAP_GUARD_OVERHEAD;
+
+			/* Ensure that blocks are always aligned to the required number of
+			bytes. */
+			if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0x00 )
+			{
+				/* Byte alignment required. */
+				xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			if( xWantedSize < xMinimumBlockSize )
+			{
+				xWantedSize = xMinimumBlockSize;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			/* Round the search size up to the start of the next second level
+			range, so any block on the list found is big enough and the list
+			never has to be searched. */
+			if( xWantedSize >= heapSMALL_BLOCK_SIZE )
+			{
+				prvMapSize( xWantedSize + ( ( ( size_t ) 1 << ( prvFindLastSet( ( uint32_t ) xWantedSize ) - configHEAP_TLSF_SL_BITS ) ) - 1 ), &uxFirst, &uxSecond );
+			}
+			else
+			{
+				prvMapSize( xWantedSize, &uxFirst, &uxSecond );
+			}
+
+			if( uxFirst < configHEAP_TLSF_FL_COUNT )
+			{
+				/* Look for a non-empty list at or above the wanted size in the
+				same power of two first, then in the next power of two that has
+				any free block at all. */
+				ulMap = ulSecondLevelMap[ uxFirst ] & ( ~0UL << uxSecond );
+
+				if( ulMap == 0 )
+				{
+					ulMap = ulFirstLevelMap & ( ~0UL << ( uxFirst + 1 ) );
+
+					if( ulMap != 0 )
+					{
+						uxFirst = heapFIND_FIRST_SET( ulMap );
+						ulMap = ulSecondLevelMap[ uxFirst ];
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				if( ulMap != 0 )
+				{
+					uxSecond = heapFIND_FIRST_SET( ulMap );
+					pxBlock = pxFreeLists[ uxFirst ][ uxSecond ];
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			if( ( pxBlock == NULL ) && ( xWantedSize >= heapSMALL_BLOCK_SIZE ) )
+			{
+				/* Nothing free in a higher range, but the head of the list the
+				size itself falls in may still be big enough.  Checking the head
+				only keeps this constant time, and lets a request close to the
+				size of the largest free block succeed. */
+				prvMapSize( xWantedSize, &uxFirst, &uxSecond );
+				pxBlock = pxFreeLists[ uxFirst ][ uxSecond ];
+
+				if( ( pxBlock != NULL ) && ( heapBLOCK_SIZE( pxBlock ) < xWantedSize ) )
+				{
+					pxBlock = NULL;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			if( pxBlock != NULL )
+			{
+				/* This block is being returned for use so must be taken out
+				of the list of free blocks. */
+				prvRemoveFreeBlock( pxBlock );
+				pxBlock->xBlockSize &= ~heapBLOCK_FREE_BIT;
+
+				/* If the block is larger than required it can be split into
+				two. */
+				if( ( pxBlock->xBlockSize - xWantedSize ) >= xMinimumBlockSize )
+				{
+					/* This block is to be split into two.  Create a new block
+					following the number of bytes requested. The void cast is
+					used to prevent byte alignment warnings from the compiler. */
+					pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+
+					/* Calculate the sizes of two blocks split from the single
+					block, and keep the physical back links intact. */
+					pxNewBlockLink->xBlockSize = pxBlock->xBlockSize - xWantedSize;
+					pxNewBlockLink->pxPrevPhysicalBlock = pxBlock;
+					heapNEXT_PHYSICAL( pxNewBlockLink )->pxPrevPhysicalBlock = pxNewBlockLink;
+					pxBlock->xBlockSize = xWantedSize;
+
+					/* Insert the new block into the list of free blocks. */
+					prvInsertFreeBlock( pxNewBlockLink );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				xFreeBytesRemaining -= pxBlock->xBlockSize;
+
+				if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+				{
+					xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* Return the memory space pointed to - jumping over the block
+				header at its start. */
+				pvReturn = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xHeapStructSize );
+				portHEAP_TAG_RECORD( pvReturn, pxBlock->xBlockSize );
+				portHEAP_GUARD_ARM( pvReturn, xRequestedSize, pxBlock->xBlockSize - xHeapStructSize );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		portHEAP_TIMING_STOP( portHEAP_TIMING_MALLOC );
+	}
+	( void ) xTaskResumeAll();
+
+	portHEAP_TRACE_MALLOC( pvReturn, xRequestedSize );
+
+	#if( configHEAP_USE_RECLAIM == 1 )
+	{
+		if( pvReturn != NULL )
+		{
+			vPortHeapReclaimCheck( portHEAP_RECLAIM_HEAP, xFreeBytesRemaining );
+		}
+		else if( ( xRequestedSize > 0 ) && ( xPortHeapReclaimBegin( portHEAP_RECLAIM_HEAP ) == pdTRUE ) )
+		{
+			/* The callbacks may have freed enough, so try once more.  The
+			retry calls the malloc failed hook if it fails too. */
+			pvReturn = pvPortMalloc( xRequestedSize );
+			vPortHeapReclaimEnd();
+			return pvReturn;
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+uint8_t *puc = ( uint8_t * ) pv;
+BlockLink_t *pxLink, *pxNeighbour;
+
+	if( pv != NULL )
+	{
+		/* The memory being freed will have a block header immediately before
+		it. */
+		puc -= xHeapStructSize;
+
+		/* This casting is to keep the compiler from issuing warnings. */
+		pxLink = ( void * ) puc;
+
+		#if( configHEAP_USE_GUARDS == 1 )
+		{
+			if( heapBLOCK_IS_FREE( pxLink ) || ( ( pxLink->xBlockSize - xHeapStructSize ) > configTOTAL_HEAP_SIZE ) ||
+				( xPortHeapGuardCheck( pv, pxLink->xBlockSize - xHeapStructSize ) == pdFALSE ) )
+			{
+				configHEAP_GUARD_FAILED( pv );
+				return;
+			}
+		}
+		#endif
+
+		configASSERT( heapBLOCK_IS_FREE( pxLink ) == pdFALSE );
+
+		if( heapBLOCK_IS_FREE( pxLink ) == pdFALSE )
+		{
+			vTaskSuspendAll();
+			{
+				portHEAP_TIMING_START( portHEAP_TIMING_FREE );
+
+				portHEAP_TAG_FORGET( pv );
+				portHEAP_TRACE_FREE( pv );
+				portHEAP_GUARD_POISON( pv, pxLink->xBlockSize - xHeapStructSize );
+				xFreeBytesRemaining += pxLink->xBlockSize;
+
+				/* Merge with the block above if it is free.  pxEnd is never
+				free, so this never runs off the top of the heap. */
+				pxNeighbour = heapNEXT_PHYSICAL( pxLink );
+				if( heapBLOCK_IS_FREE( pxNeighbour ) )
+				{
+					prvRemoveFreeBlock( pxNeighbour );
+					pxLink->xBlockSize += heapBLOCK_SIZE( pxNeighbour );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* Merge with the block below if it is free. */
+				pxNeighbour = pxLink->pxPrevPhysicalBlock;
+				if( ( pxNeighbour != NULL ) && heapBLOCK_IS_FREE( pxNeighbour ) )
+				{
+					prvRemoveFreeBlock( pxNeighbour );
+					pxNeighbour->xBlockSize = heapBLOCK_SIZE( pxNeighbour ) + pxLink->xBlockSize;
+					pxLink = pxNeighbour;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				heapNEXT_PHYSICAL( pxLink )->pxPrevPhysicalBlock = pxLink;
+				prvInsertFreeBlock( pxLink );
+
+				portHEAP_TIMING_STOP( portHEAP_TIMING_FREE );
+			}
+			( void ) xTaskResumeAll();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void )
+{
+BlockLink_t *pxFirstFreeBlock;
+uint8_t *pucAlignedHeap;
+size_t uxAddress;
+size_t xTotalHeapSize = configTOTAL_HEAP_SIZE;
+
+	/* Ensure the heap starts on a correctly aligned boundary. */
+	uxAddress = ( size_t ) ucHeap;
+
+	if( ( uxAddress & portBYTE_ALIGNMENT_MASK ) != 0 )
+	{
+		uxAddress += ( portBYTE_ALIGNMENT - 1 );
+		uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+		xTotalHeapSize -= uxAddress - ( size_t ) ucHeap;
+	}
+
+	pucAlignedHeap = ( uint8_t * ) uxAddress;
+
+	uxSmallBlockShift = prvFindLastSet( ( uint32_t ) heapSMALL_BLOCK_SIZE );
+
+	/* pxEnd is used to mark the end of the heap.  It looks like an allocated
+	block, so the block below it is never merged with anything past it. */
+	uxAddress = ( ( size_t ) pucAlignedHeap ) + xTotalHeapSize;
+	uxAddress -= xHeapStructSize;
+	uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+	pxEnd = ( void * ) uxAddress;
+	pxEnd->xBlockSize = 0;
+
+	/* To start with there is a single free block that is sized to take up the
+	entire heap space, minus the space taken by pxEnd. */
+	pxFirstFreeBlock = ( void * ) pucAlignedHeap;
+	pxFirstFreeBlock->xBlockSize = uxAddress - ( size_t ) pxFirstFreeBlock;
+	pxFirstFreeBlock->pxPrevPhysicalBlock = NULL;
+	pxEnd->pxPrevPhysicalBlock = pxFirstFreeBlock;
+	prvInsertFreeBlock( pxFirstFreeBlock );
+
+	/* Only one block exists - and it covers the entire usable heap space. */
+	xMinimumEverFreeBytesRemaining = pxFirstFreeBlock->xBlockSize & ~heapBLOCK_FREE_BIT;
+	xFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+static void prvMapSize( size_t xSize, UBaseType_t *puxFirst, UBaseType_t *puxSecond )
+{
+UBaseType_t uxLastSet;
+
+	if( xSize < heapSMALL_BLOCK_SIZE )
+	{
+		/* Small blocks are spread evenly over the lists of level 0. */
+		*puxFirst = 0;
+		*puxSecond = ( UBaseType_t ) ( xSize / portBYTE_ALIGNMENT );
+	}
+	else
+	{
+		/* The top configHEAP_TLSF_SL_BITS bits below the most significant
+		one pick the second level list. */
+		uxLastSet = prvFindLastSet( ( uint32_t ) xSize );
+		*puxSecond = ( UBaseType_t ) ( ( xSize >> ( uxLastSet - configHEAP_TLSF_SL_BITS ) ) ^ heapSL_COUNT );
+		*puxFirst = uxLastSet - uxSmallBlockShift + 1;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFreeBlock( BlockLink_t *pxBlock )
+{
+UBaseType_t uxFirst, uxSecond;
+
+	portHEAP_TIMING_START( portHEAP_TIMING_INSERT );
+
+	prvMapSize( heapBLOCK_SIZE( pxBlock ), &uxFirst, &uxSecond );
+
+	pxBlock->xBlockSize |= heapBLOCK_FREE_BIT;
+	pxBlock->pxPrevFreeBlock = NULL;
+	pxBlock->pxNextFreeBlock = pxFreeLists[ uxFirst ][ uxSecond ];
+
+	if( pxBlock->pxNextFreeBlock != NULL )
+	{
+		pxBlock->pxNextFreeBlock->pxPrevFreeBlock = pxBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	pxFreeLists[ uxFirst ][ uxSecond ] = pxBlock;
+	ulFirstLevelMap |= ( 1UL << uxFirst );
+	ulSecondLevelMap[ uxFirst ] |= ( 1UL << uxSecond );
+
+	portHEAP_TIMING_STOP( portHEAP_TIMING_INSERT );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveFreeBlock( BlockLink_t *pxBlock )
+{
+UBaseType_t uxFirst, uxSecond;
+
+	prvMapSize( heapBLOCK_SIZE( pxBlock ), &uxFirst, &uxSecond );
+
+	if( pxBlock->pxNextFreeBlock != NULL )
+	{
+		pxBlock->pxNextFreeBlock->pxPrevFreeBlock = pxBlock->pxPrevFreeBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( pxBlock->pxPrevFreeBlock != NULL )
+	{
+		pxBlock->pxPrevFreeBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+	}
+	else
+	{
+		/* The block was the head of its list.  Clear the bitmaps if the list
+		is now empty. */
+		pxFreeLists[ uxFirst ][ uxSecond ] = pxBlock->pxNextFreeBlock;
+
+		if( pxBlock->pxNextFreeBlock == NULL )
+		{
+			ulSecondLevelMap[ uxFirst ] &= ~( 1UL << uxSecond );
+
+			if( ulSecondLevelMap[ uxFirst ] == 0 )
+			{
+				ulFirstLevelMap &= ~( 1UL << uxFirst );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static UBaseType_t prvFindLastSet( uint32_t ulValue )
+{
+UBaseType_t uxBit = 0;
+
+	/* A binary search, so the time taken does not depend on the value. */
+	if( ( ulValue & 0xFFFF0000UL ) != 0 ) { ulValue >>= 16; uxBit += 16; }
+	if( ( ulValue & 0x0000FF00UL ) != 0 ) { ulValue >>= 8; uxBit += 8; }
+	if( ( ulValue & 0x000000F0UL ) != 0 ) { ulValue >>= 4; uxBit += 4; }
+	if( ( ulValue & 0x0000000CUL ) != 0 ) { ulValue >>= 2; uxBit += 2; }
+	if( ( ulValue & 0x00000002UL ) != 0 ) { uxBit += 1; }
+
+	return uxBit;
+}